@@ -0,0 +1,440 @@
+#include <ar.h>
+#include <elf.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Writes a synthetic relocatable ELF object, or an archive of them, with a
+// reproducible symbol table:
+//
+//   elf_gen [-c 32|64] [-e lsb|msb] [-n symbols] [-l short|mixed|long|cxx]
+//           [-s text|mixed] [-m members] [-S seed] -o output
+//
+// Section names are stored at the same offsets in .shstrtab and .strtab, so
+// the listings of ft_nm and binutils nm can be compared on these files.
+
+enum name_dist { NAMES_SHORT, NAMES_MIXED, NAMES_LONG, NAMES_CXX };
+
+enum section_mix { MIX_TEXT, MIX_MIXED };
+
+struct gen_options {
+    int bits;
+    bool msb;
+    size_t symbols;
+    enum name_dist names;
+    enum section_mix mix;
+    size_t members;
+    unsigned long seed;
+    const char *output;
+};
+
+struct buffer {
+    unsigned char *data;
+    size_t len;
+    size_t cap;
+};
+
+// Section indices; the names are the leading strings of both string tables.
+enum { SEC_NULL, SEC_TEXT, SEC_DATA, SEC_BSS, SEC_RODATA, SEC_SYMTAB, SEC_STRTAB, SEC_SHSTRTAB, SEC_COUNT };
+
+static const char *section_names[SEC_COUNT] = {"", ".text", ".data", ".bss", ".rodata", ".symtab", ".strtab", ".shstrtab"};
+
+#define SECTION_SIZE 4096
+
+static const char *namespaces[] = {"4llvm", "5clang", "3std", "5boost", "6detail", "4absl"};
+static const char *classes[] = {"6Parser", "8Sema", "10ASTContext", "6vectorIiSaIiEE", "9allocator", "12basic_string"};
+static const char *methods[] = {"4init", "5parse", "7destroy", "3get", "3set", "11emplaceBack", "4size"};
+
+static unsigned long rng_state;
+
+static unsigned long rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void buffer_reserve(struct buffer *buf, size_t len) {
+    if (buf->len + len <= buf->cap) {
+        return;
+    }
+
+    size_t cap = buf->cap ? buf->cap : 4096;
+
+    while (cap < buf->len + len) {
+        cap *= 2;
+    }
+
+    if (!(buf->data = realloc(buf->data, cap))) {
+        perror("elf_gen");
+        exit(1);
+    }
+
+    buf->cap = cap;
+}
+
+static void buffer_append(struct buffer *buf, const void *data, size_t len) {
+    buffer_reserve(buf, len);
+    memcpy(buf->data + buf->len, data, len);
+    buf->len += len;
+}
+
+static void buffer_zero(struct buffer *buf, size_t len) {
+    buffer_reserve(buf, len);
+    memset(buf->data + buf->len, 0, len);
+    buf->len += len;
+}
+
+// Stores `value` as a `width` byte integer in the file's byte order.
+static void put(struct buffer *buf, const struct gen_options *opts, unsigned long value, size_t width) {
+    unsigned char bytes[8];
+
+    for (size_t i = 0; i < width; i++) {
+        bytes[opts->msb ? width - 1 - i : i] = value >> (8 * i);
+    }
+
+    buffer_append(buf, bytes, width);
+}
+
+// Addresses, offsets and sizes follow the class.
+static void put_word(struct buffer *buf, const struct gen_options *opts, unsigned long value) {
+    put(buf, opts, value, opts->bits / 8);
+}
+
+static void append_name(struct buffer *strtab, const struct gen_options *opts, size_t index) {
+    unsigned long r = rng();
+    char name[512];
+    size_t len = 0;
+
+    switch (opts->names) {
+        case NAMES_SHORT:
+            len = snprintf(name, sizeof(name), "s%lx", (r % (opts->symbols * 4 + 1)) ^ index);
+            break;
+
+        case NAMES_MIXED:
+        case NAMES_LONG: {
+            size_t min = opts->names == NAMES_MIXED ? 4 : 64,
+                   span = opts->names == NAMES_MIXED ? 60 : 192;
+            size_t target = min + r % span;
+
+            len = snprintf(name, sizeof(name), "sym_%zx_", index);
+
+            while (len < target) {
+                name[len++] = 'a' + (rng() % 26);
+            }
+
+            name[len] = '\0';
+            break;
+        }
+
+        case NAMES_CXX:
+            len = snprintf(name, sizeof(name), "_ZN%s%s%sE%zx", namespaces[r % 6], classes[(r >> 8) % 6], methods[(r >> 16) % 7], index);
+            break;
+    }
+
+    buffer_append(strtab, name, len + 1);
+}
+
+// Picks the section, binding and type of one symbol.
+static void pick_symbol(const struct gen_options *opts, unsigned int *shndx, unsigned char *info) {
+    unsigned long r = rng();
+    unsigned int bind = r % 10 < 7 ? STB_GLOBAL : r % 10 < 9 ? STB_LOCAL : STB_WEAK;
+
+    if (opts->mix == MIX_TEXT) {
+        *shndx = SEC_TEXT;
+        *info = ELF64_ST_INFO(bind, STT_FUNC);
+        return;
+    }
+
+    switch ((r >> 8) % 16) {
+        case 0:
+        case 1:
+            *shndx = SHN_UNDEF;
+            *info = ELF64_ST_INFO(bind == STB_WEAK ? STB_WEAK : STB_GLOBAL, STT_NOTYPE);
+            break;
+        case 2:
+            *shndx = SHN_COMMON;
+            *info = ELF64_ST_INFO(STB_GLOBAL, STT_OBJECT);
+            break;
+        case 3:
+        case 4:
+            *shndx = SEC_DATA;
+            *info = ELF64_ST_INFO(bind, STT_OBJECT);
+            break;
+        case 5:
+            *shndx = SEC_BSS;
+            *info = ELF64_ST_INFO(bind, STT_OBJECT);
+            break;
+        case 6:
+            *shndx = SEC_RODATA;
+            *info = ELF64_ST_INFO(bind, STT_OBJECT);
+            break;
+        default:
+            *shndx = SEC_TEXT;
+            *info = ELF64_ST_INFO(bind, STT_FUNC);
+            break;
+    }
+}
+
+static void put_symbol(struct buffer *buf, const struct gen_options *opts, unsigned long name, unsigned char info, unsigned int shndx, unsigned long value, unsigned long size) {
+    if (opts->bits == 64) {
+        put(buf, opts, name, 4);
+        buffer_append(buf, &info, 1);
+        buffer_zero(buf, 1);
+        put(buf, opts, shndx, 2);
+        put(buf, opts, value, 8);
+        put(buf, opts, size, 8);
+    } else {
+        put(buf, opts, name, 4);
+        put(buf, opts, value, 4);
+        put(buf, opts, size, 4);
+        buffer_append(buf, &info, 1);
+        buffer_zero(buf, 1);
+        put(buf, opts, shndx, 2);
+    }
+}
+
+static void put_section(struct buffer *buf, const struct gen_options *opts, unsigned long name, unsigned int type, unsigned long flags, unsigned long offset, unsigned long size, unsigned int link, unsigned int info, unsigned long align, unsigned long entsize) {
+    put(buf, opts, name, 4);
+    put(buf, opts, type, 4);
+    put_word(buf, opts, flags);
+    put_word(buf, opts, 0);
+    put_word(buf, opts, offset);
+    put_word(buf, opts, size);
+    put(buf, opts, link, 4);
+    put(buf, opts, info, 4);
+    put_word(buf, opts, align);
+    put_word(buf, opts, entsize);
+}
+
+// Appends one object with `count` symbols to `out`; the names of its global
+// definitions are added to `globals` for the archive index.
+static void generate_object(struct buffer *out, const struct gen_options *opts, size_t count, size_t first, struct buffer *globals, size_t *global_count) {
+    struct buffer symtab = {0}, strtab = {0}, shstrtab = {0};
+    unsigned long name_offsets[SEC_COUNT];
+    size_t ehdr_size = opts->bits == 64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr),
+           shdr_size = opts->bits == 64 ? sizeof(Elf64_Shdr) : sizeof(Elf32_Shdr),
+           sym_size = opts->bits == 64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+
+    for (size_t i = 0; i < SEC_COUNT; i++) {
+        name_offsets[i] = shstrtab.len;
+        buffer_append(&shstrtab, section_names[i], strlen(section_names[i]) + 1);
+    }
+
+    buffer_append(&strtab, shstrtab.data, shstrtab.len);
+
+    // Locals have to come first; the generator emits them in one pass by
+    // writing globals into a second table and appending it afterwards.
+    struct buffer globals_symtab = {0};
+    size_t locals = 1;
+
+    put_symbol(&symtab, opts, 0, 0, SHN_UNDEF, 0, 0);
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned int shndx;
+        unsigned char info;
+        unsigned long name = strtab.len;
+
+        pick_symbol(opts, &shndx, &info);
+        append_name(&strtab, opts, first + i);
+
+        unsigned long value = shndx == SHN_UNDEF ? 0 : shndx == SHN_COMMON ? 8 : (rng() % (SECTION_SIZE / 8)) * 8;
+        bool local = ELF64_ST_BIND(info) == STB_LOCAL;
+
+        put_symbol(local ? &symtab : &globals_symtab, opts, name, info, shndx, value, 8);
+
+        if (local) {
+            locals++;
+        } else if (shndx != SHN_UNDEF && globals) {
+            buffer_append(globals, strtab.data + name, strlen((char *) strtab.data + name) + 1);
+            ++*global_count;
+        }
+    }
+
+    buffer_append(&symtab, globals_symtab.data, globals_symtab.len);
+    free(globals_symtab.data);
+
+    size_t base = out->len;
+    size_t text = ehdr_size, data = text + SECTION_SIZE, rodata = data + SECTION_SIZE,
+           sym = rodata + SECTION_SIZE, str = sym + symtab.len, shstr = str + strtab.len,
+           shoff = (shstr + shstrtab.len + 7) & ~7UL;
+
+    unsigned char ident[EI_NIDENT] = {ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3};
+    ident[EI_CLASS] = opts->bits == 64 ? ELFCLASS64 : ELFCLASS32;
+    ident[EI_DATA] = opts->msb ? ELFDATA2MSB : ELFDATA2LSB;
+    ident[EI_VERSION] = EV_CURRENT;
+
+    buffer_append(out, ident, EI_NIDENT);
+    put(out, opts, ET_REL, 2);
+    put(out, opts, opts->bits == 64 ? (opts->msb ? EM_PPC64 : EM_X86_64) : (opts->msb ? EM_PPC : EM_386), 2);
+    put(out, opts, EV_CURRENT, 4);
+    put_word(out, opts, 0);
+    put_word(out, opts, 0);
+    put_word(out, opts, shoff);
+    put(out, opts, 0, 4);
+    put(out, opts, ehdr_size, 2);
+    put(out, opts, 0, 2);
+    put(out, opts, 0, 2);
+    put(out, opts, shdr_size, 2);
+    put(out, opts, SEC_COUNT, 2);
+    put(out, opts, SEC_SHSTRTAB, 2);
+
+    buffer_zero(out, 3 * SECTION_SIZE);
+    buffer_append(out, symtab.data, symtab.len);
+    buffer_append(out, strtab.data, strtab.len);
+    buffer_append(out, shstrtab.data, shstrtab.len);
+    buffer_zero(out, base + shoff - out->len);
+
+    put_section(out, opts, 0, SHT_NULL, 0, 0, 0, 0, 0, 0, 0);
+    put_section(out, opts, name_offsets[SEC_TEXT], SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR, text, SECTION_SIZE, 0, 0, 16, 0);
+    put_section(out, opts, name_offsets[SEC_DATA], SHT_PROGBITS, SHF_ALLOC | SHF_WRITE, data, SECTION_SIZE, 0, 0, 8, 0);
+    put_section(out, opts, name_offsets[SEC_BSS], SHT_NOBITS, SHF_ALLOC | SHF_WRITE, rodata, SECTION_SIZE, 0, 0, 8, 0);
+    put_section(out, opts, name_offsets[SEC_RODATA], SHT_PROGBITS, SHF_ALLOC, rodata, SECTION_SIZE, 0, 0, 8, 0);
+    put_section(out, opts, name_offsets[SEC_SYMTAB], SHT_SYMTAB, 0, sym, symtab.len, SEC_STRTAB, locals, 8, sym_size);
+    put_section(out, opts, name_offsets[SEC_STRTAB], SHT_STRTAB, 0, str, strtab.len, 0, 0, 1, 0);
+    put_section(out, opts, name_offsets[SEC_SHSTRTAB], SHT_STRTAB, 0, shstr, shstrtab.len, 0, 0, 1, 0);
+
+    free(symtab.data);
+    free(strtab.data);
+    free(shstrtab.data);
+}
+
+static void put_ar_header(struct buffer *out, const char *name, size_t size) {
+    char header[128];
+
+    snprintf(header, sizeof(header), "%-16s%-12d%-6d%-6d%-8o%-10zu`\n", name, 0, 0, 0, 0644, size);
+    buffer_append(out, header, 60);
+}
+
+static void put_be32(struct buffer *out, unsigned long value) {
+    unsigned char bytes[4] = {value >> 24, value >> 16, value >> 8, value};
+
+    buffer_append(out, bytes, 4);
+}
+
+// Writes a SysV archive with a "/" symbol index in front of its members.
+static void generate_archive(struct buffer *out, const struct gen_options *opts) {
+    struct buffer members = {0}, names = {0};
+    size_t *offsets = calloc(opts->members, sizeof(size_t)), *counts = calloc(opts->members, sizeof(size_t));
+    size_t per_member = opts->symbols / opts->members, total = 0;
+
+    for (size_t m = 0; m < opts->members; m++) {
+        struct buffer object = {0};
+        char name[32];
+        size_t count = m + 1 == opts->members ? opts->symbols - per_member * m : per_member;
+
+        generate_object(&object, opts, count, per_member * m, &names, &counts[m]);
+        offsets[m] = members.len;
+        total += counts[m];
+
+        snprintf(name, sizeof(name), "m%06zu.o/", m);
+        put_ar_header(&members, name, object.len);
+        buffer_append(&members, object.data, object.len);
+
+        if (object.len & 1) {
+            buffer_append(&members, "\n", 1);
+        }
+
+        free(object.data);
+    }
+
+    // Like GNU ar, the name list is padded so the index keeps members aligned.
+    if (names.len & 1) {
+        buffer_zero(&names, 1);
+    }
+
+    size_t index_size = 4 + 4 * total + names.len, first_member = SARMAG + 60 + index_size;
+
+    buffer_append(out, ARMAG, SARMAG);
+    put_ar_header(out, "/", index_size);
+    put_be32(out, total);
+
+    for (size_t m = 0; m < opts->members; m++) {
+        for (size_t i = 0; i < counts[m]; i++) {
+            put_be32(out, first_member + offsets[m]);
+        }
+    }
+
+    buffer_append(out, names.data, names.len);
+
+    buffer_append(out, members.data, members.len);
+
+    free(members.data);
+    free(names.data);
+    free(offsets);
+    free(counts);
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: elf_gen [-c 32|64] [-e lsb|msb] [-n symbols] [-l short|mixed|long|cxx] [-s text|mixed] [-m members] [-S seed] -o output\n");
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    struct gen_options opts = {
+        .bits = 64,
+        .symbols = 1000,
+        .names = NAMES_MIXED,
+        .mix = MIX_MIXED,
+        .seed = 0x2545F4914F6CDD1DUL,
+    };
+    int ch;
+
+    while ((ch = getopt(argc, argv, "c:e:n:l:s:m:S:o:")) != -1) {
+        switch (ch) {
+            case 'c':
+                opts.bits = atoi(optarg);
+                break;
+            case 'e':
+                opts.msb = !strcmp(optarg, "msb");
+                break;
+            case 'n':
+                opts.symbols = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                opts.names = !strcmp(optarg, "short") ? NAMES_SHORT : !strcmp(optarg, "long") ? NAMES_LONG : !strcmp(optarg, "cxx") ? NAMES_CXX : NAMES_MIXED;
+                break;
+            case 's':
+                opts.mix = !strcmp(optarg, "text") ? MIX_TEXT : MIX_MIXED;
+                break;
+            case 'm':
+                opts.members = strtoul(optarg, NULL, 10);
+                break;
+            case 'S':
+                opts.seed = strtoul(optarg, NULL, 0) | 1;
+                break;
+            case 'o':
+                opts.output = optarg;
+                break;
+            default:
+                return usage();
+        }
+    }
+
+    if (!opts.output || (opts.bits != 32 && opts.bits != 64) || (opts.members && opts.members > opts.symbols)) {
+        return usage();
+    }
+
+    struct buffer out = {0};
+
+    rng_state = opts.seed;
+
+    if (opts.members) {
+        generate_archive(&out, &opts);
+    } else {
+        generate_object(&out, &opts, opts.symbols, 0, NULL, NULL);
+    }
+
+    FILE *file = fopen(opts.output, "wb");
+
+    if (!file || fwrite(out.data, 1, out.len, file) != out.len || fclose(file)) {
+        perror(opts.output);
+        return 1;
+    }
+
+    free(out.data);
+
+    return 0;
+}
@@ -0,0 +1,267 @@
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// Times ft_nm against binutils nm over inputs made by elf_gen:
+//
+//   nm_bench [-f ft_nm] [-n nm] [-g elf_gen] [-r repeats] [-d dir] [-L] [-k]
+//
+// Every run is the best of `repeats`, with stdout sent to /dev/null. Peak RSS
+// comes from wait4(). The phase line is ft_nm's own --stats=json breakdown
+// next to the time a plain read of the file takes.
+
+struct bench_case {
+    const char *name;
+    const char *bits;
+    const char *order;
+    const char *symbols;
+    const char *names;
+    const char *mix;
+    const char *members;
+    bool large;
+};
+
+static const struct bench_case cases[] = {
+    {"elf64-lsb-1k-short", "64", "lsb", "1000", "short", "mixed", NULL, false},
+    {"elf64-lsb-100k-mixed", "64", "lsb", "100000", "mixed", "mixed", NULL, false},
+    {"elf64-lsb-1m-cxx", "64", "lsb", "1000000", "cxx", "mixed", NULL, false},
+    {"elf64-lsb-1m-text", "64", "lsb", "1000000", "mixed", "text", NULL, false},
+    {"elf32-lsb-1m-mixed", "32", "lsb", "1000000", "mixed", "mixed", NULL, false},
+    {"elf64-msb-1m-mixed", "64", "msb", "1000000", "mixed", "mixed", NULL, false},
+    {"elf32-msb-100k-long", "32", "msb", "100000", "long", "mixed", NULL, false},
+    {"ar64-lsb-256x4k-cxx", "64", "lsb", "1048576", "cxx", "mixed", "256", false},
+    {"ar32-msb-64x1k-mixed", "32", "msb", "65536", "mixed", "mixed", "64", false},
+    {"elf64-lsb-10m-cxx", "64", "lsb", "10000000", "cxx", "mixed", NULL, true},
+    {"ar64-lsb-4096x2k-long", "64", "lsb", "8388608", "long", "mixed", "4096", true},
+};
+
+struct run_result {
+    double seconds;
+    long rss_kb;
+    int status;
+};
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Runs `argv` with its output discarded, or its stderr kept in `err_path`.
+static struct run_result run(char **argv, const char *err_path) {
+    struct run_result result = {0};
+    struct rusage usage;
+    double start = now();
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        int null = open("/dev/null", O_WRONLY),
+            err = err_path ? open(err_path, O_WRONLY | O_CREAT | O_TRUNC, 0644) : null;
+
+        dup2(null, STDOUT_FILENO);
+        dup2(err, STDERR_FILENO);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+
+    if (pid < 0 || wait4(pid, &result.status, 0, &usage) < 0) {
+        result.status = -1;
+        return result;
+    }
+
+    result.seconds = now() - start;
+    result.rss_kb = usage.ru_maxrss;
+
+    return result;
+}
+
+static struct run_result best_of(char **argv, int repeats) {
+    struct run_result best = {0};
+
+    for (int i = 0; i < repeats; i++) {
+        struct run_result result = run(argv, NULL);
+
+        if (result.status) {
+            return result;
+        }
+
+        if (!i || result.seconds < best.seconds) {
+            best.seconds = result.seconds;
+        }
+
+        if (result.rss_kb > best.rss_kb) {
+            best.rss_kb = result.rss_kb;
+        }
+    }
+
+    return best;
+}
+
+// Reads the whole file once, which is the floor for any tool on a warm cache.
+static double read_time(const char *path, int repeats) {
+    static char buffer[1 << 16];
+    double best = 0;
+
+    for (int i = 0; i < repeats; i++) {
+        int fd = open(path, O_RDONLY);
+        double start = now();
+
+        while (fd >= 0 && read(fd, buffer, sizeof(buffer)) > 0) {
+        }
+
+        double elapsed = now() - start;
+
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        if (!i || elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+// Pulls the per-phase totals out of the last line of a --stats=json run.
+static bool read_phases(const char *path, unsigned long *ns) {
+    char line[4096], last[4096] = "";
+    FILE *file = fopen(path, "r");
+
+    if (!file) {
+        return false;
+    }
+
+    while (fgets(line, sizeof(line), file)) {
+        memcpy(last, line, sizeof(line));
+    }
+
+    fclose(file);
+
+    char *phases = strstr(last, "\"phases_ns\":");
+
+    return phases && sscanf(phases, "\"phases_ns\":{\"map\":%lu,\"scan\":%lu,\"decode\":%lu,\"sort\":%lu,\"print\":%lu",
+                            &ns[0], &ns[1], &ns[2], &ns[3], &ns[4]) == 5;
+}
+
+static void report(const char *tool, struct run_result result, double symbols, double megabytes) {
+    if (result.status) {
+        printf("  %-6s  failed (status %d)\n", tool, result.status);
+        return;
+    }
+
+    printf("  %-6s %9.1f ms %9.2f Msym/s %8.1f MB/s %8.1f MB RSS\n", tool, result.seconds * 1000,
+           symbols / result.seconds / 1e6, megabytes / result.seconds, result.rss_kb / 1024.0);
+}
+
+static int usage(void) {
+    fprintf(stderr, "usage: nm_bench [-f ft_nm] [-n nm] [-g elf_gen] [-r repeats] [-d dir] [-L] [-k]\n");
+    return 1;
+}
+
+int main(int argc, char **argv) {
+    char *ft_nm = "./ft_nm", *nm = "nm", *elf_gen = "./bench/elf_gen", *dir = NULL;
+    char dir_template[] = "/tmp/ft_nm_bench.XXXXXX";
+    bool large = false, keep = false;
+    int repeats = 3, ch;
+
+    while ((ch = getopt(argc, argv, "f:n:g:r:d:Lk")) != -1) {
+        switch (ch) {
+            case 'f':
+                ft_nm = optarg;
+                break;
+            case 'n':
+                nm = optarg;
+                break;
+            case 'g':
+                elf_gen = optarg;
+                break;
+            case 'r':
+                repeats = atoi(optarg) > 0 ? atoi(optarg) : 1;
+                break;
+            case 'd':
+                dir = optarg;
+                break;
+            case 'L':
+                large = true;
+                break;
+            case 'k':
+                keep = true;
+                break;
+            default:
+                return usage();
+        }
+    }
+
+    if (!dir && !(dir = mkdtemp(dir_template))) {
+        perror("nm_bench");
+        return 1;
+    }
+
+    char *nm_probe[] = {nm, "--version", NULL};
+    bool has_nm = !run(nm_probe, NULL).status;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        const struct bench_case *c = &cases[i];
+        char path[4096];
+        struct stat st;
+
+        if (c->large && !large) {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s%s", dir, c->name, c->members ? ".a" : ".o");
+
+        char *gen[] = {
+            elf_gen, "-c", (char *) c->bits, "-e", (char *) c->order, "-n", (char *) c->symbols,
+            "-l", (char *) c->names, "-s", (char *) c->mix, "-o", path,
+            c->members ? "-m" : NULL, (char *) c->members, NULL,
+        };
+
+        if (run(gen, NULL).status || stat(path, &st) < 0) {
+            fprintf(stderr, "nm_bench: %s: unable to generate input\n", c->name);
+            return 1;
+        }
+
+        double symbols = atof(c->symbols), megabytes = st.st_size / 1048576.0;
+        char *ft_sorted[] = {ft_nm, path, NULL}, *binutils[] = {nm, path, NULL};
+        char *ft_stats[] = {ft_nm, "--stats=json", path, NULL};
+        struct run_result sorted = best_of(ft_sorted, repeats);
+        char stats_path[4096 + 8];
+        unsigned long ns[5];
+
+        printf("%s: %.1f MB, %s symbols\n", c->name, megabytes, c->symbols);
+        report("ft_nm", sorted, symbols, megabytes);
+
+        if (has_nm) {
+            report("nm", best_of(binutils, repeats), symbols, megabytes);
+        }
+
+        snprintf(stats_path, sizeof(stats_path), "%s.stats", path);
+
+        if (!run(ft_stats, stats_path).status && read_phases(stats_path, ns)) {
+            printf("  phases  read %.1f ms | map %.1f, scan %.1f, decode %.1f, sort %.1f, print %.1f ms\n",
+                   read_time(path, repeats) * 1000, ns[0] / 1e6, ns[1] / 1e6, ns[2] / 1e6, ns[3] / 1e6, ns[4] / 1e6);
+        }
+
+        unlink(stats_path);
+
+        if (!keep) {
+            unlink(path);
+        }
+    }
+
+    if (!keep && dir == dir_template) {
+        rmdir(dir);
+    }
+
+    return 0;
+}
@@ -0,0 +1,205 @@
+#include <libft/stdio.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <time.h>
+
+#include "ft_nm.h"
+
+// Sorts a synthetic table of C++-style mangled names twice: once with the
+// plain ft_strcmp merge sort the decoders used to run, once with
+// symbol_table_sort(), and checks both agree before reporting timings. The
+// same is then done for -n, with addresses that often collide.
+
+#define DEFAULT_SYMBOLS 1000000
+
+static const char *namespaces[] = {"4llvm", "5clang", "3std", "5boost", "6detail", "4absl"};
+static const char *classes[] = {"6Parser", "8Sema", "10ASTContext", "6vectorIiSaIiEE", "9allocator", "12basic_string"};
+static const char *methods[] = {"4init", "5parse", "7destroy", "3get", "3set", "11emplaceBack", "4size"};
+
+static unsigned long rng_state = 0x2545F4914F6CDD1DUL;
+
+static unsigned long rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *make_names(size_t count, char **names) {
+    char *pool = ft_malloc(count * 96), *ptr = pool;
+
+    if (!pool) {
+        return NULL;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned long r = rng();
+        const char *parts[] = {
+            namespaces[r % 6], classes[(r >> 8) % 6], methods[(r >> 16) % 7],
+        };
+
+        names[i] = ptr;
+
+        if (r % 10 == 0) {
+            // Plain C names, with a few deliberate duplicates.
+            ptr[0] = 'f';
+            output_hex64(ptr + 1, (r >> 24) % (count / 2 + 1));
+            ptr += 17;
+        } else {
+            ft_memcpy(ptr, "_ZN", 3);
+            ptr += 3;
+
+            for (int p = 0; p < 3; p++) {
+                size_t len = ft_strlen(parts[p]);
+                ft_memcpy(ptr, parts[p], len);
+                ptr += len;
+            }
+
+            ptr[0] = 'E';
+            output_hex64(ptr + 1, (r >> 32) % count);
+            ptr += 17;
+        }
+
+        *ptr++ = 0;
+    }
+
+    return pool;
+}
+
+static void fill(struct symbol_table *table, char **names, size_t count) {
+    symbol_table_reset(table, count);
+
+    for (size_t i = 0; i < count; i++) {
+        struct symbol_entry *entry = &table->entries[table->count++];
+
+        entry->st_name = names[i];
+        entry->st_name_len = ft_strlen(names[i]);
+        entry->key = symbol_key(names[i], entry->st_name_len);
+        entry->st_value = i;
+        entry->st_size = i;
+        entry->type = 'T';
+    }
+}
+
+static int compare_names(const struct symbol_entry *lhs, const struct symbol_entry *rhs) {
+    return ft_strcmp(lhs->st_name, rhs->st_name);
+}
+
+static int compare_values(const struct symbol_entry *lhs, const struct symbol_entry *rhs) {
+    if (lhs->st_value != rhs->st_value) {
+        return lhs->st_value < rhs->st_value ? -1 : 1;
+    }
+
+    return ft_strcmp(lhs->st_name, rhs->st_name);
+}
+
+static void merge_sort(struct symbol_entry *entries, struct symbol_entry *scratch, size_t count,
+                       int (*compare)(const struct symbol_entry *, const struct symbol_entry *)) {
+    struct symbol_entry *src = entries, *dst = scratch;
+
+    for (size_t width = 1; width < count; width *= 2) {
+        for (size_t lo = 0; lo < count; lo += 2 * width) {
+            size_t mid = lo + width < count ? lo + width : count;
+            size_t hi = lo + 2 * width < count ? lo + 2 * width : count;
+            size_t i = lo, j = mid, k = lo;
+
+            while (i < mid && j < hi) {
+                dst[k++] = compare(&src[i], &src[j]) <= 0 ? src[i++] : src[j++];
+            }
+
+            while (i < mid) {
+                dst[k++] = src[i++];
+            }
+
+            while (j < hi) {
+                dst[k++] = src[j++];
+            }
+        }
+
+        struct symbol_entry *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != entries) {
+        ft_memcpy(entries, src, count * sizeof(struct symbol_entry));
+    }
+}
+
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? (size_t) ft_atoi(argv[1]) : DEFAULT_SYMBOLS;
+    char **names = ft_malloc(count * sizeof(char *));
+    char *pool = names ? make_names(count, names) : NULL;
+    struct symbol_table before, after;
+
+    if (!pool) {
+        return 1;
+    }
+
+    strings_init();
+
+    symbol_table_init(&before);
+    symbol_table_init(&after);
+    fill(&before, names, count);
+    fill(&after, names, count);
+
+    struct symbol_entry *scratch = ft_malloc(count * sizeof(struct symbol_entry));
+    double start = now();
+    merge_sort(before.entries, scratch, count, &compare_names);
+    double strcmp_time = now() - start;
+
+    // Both orders have to be the stable one, so the values must line up.
+    start = now();
+    symbol_table_sort(&after, 0);
+    double radix_time = now() - start;
+
+    for (size_t i = 0; i < count; i++) {
+        if (before.entries[i].st_value != after.entries[i].st_value) {
+            ft_dprintf(2, "sort_bench: orders differ at %lu\n", i);
+            return 1;
+        }
+    }
+
+    // -n: the sizes carry the original position this time.
+    fill(&before, names, count);
+    fill(&after, names, count);
+
+    for (size_t i = 0; i < count; i++) {
+        before.entries[i].st_value = after.entries[i].st_value = 0x400000 + rng() % (count / 4 + 1) * 16;
+    }
+
+    start = now();
+    merge_sort(before.entries, scratch, count, &compare_values);
+    double value_merge_time = now() - start;
+
+    start = now();
+    symbol_table_sort(&after, FLAG_NUMERIC_SORT);
+    double value_radix_time = now() - start;
+
+    for (size_t i = 0; i < count; i++) {
+        if (before.entries[i].st_size != after.entries[i].st_size) {
+            ft_dprintf(2, "sort_bench: numeric orders differ at %lu\n", i);
+            return 1;
+        }
+    }
+
+    ft_printf("symbols:            %lu\n", count);
+    ft_printf("strcmp merge sort:  %d ms (%d Ksym/s)\n", (int) (strcmp_time * 1000), (int) (count / strcmp_time / 1000));
+    ft_printf("prefix radix sort:  %d ms (%d Ksym/s)\n", (int) (radix_time * 1000), (int) (count / radix_time / 1000));
+    ft_printf("-n merge sort:      %d ms (%d Ksym/s)\n", (int) (value_merge_time * 1000), (int) (count / value_merge_time / 1000));
+    ft_printf("-n radix sort:      %d ms (%d Ksym/s)\n", (int) (value_radix_time * 1000), (int) (count / value_radix_time / 1000));
+
+    symbol_table_free(&before);
+    symbol_table_free(&after);
+    ft_free(scratch);
+    ft_free(pool);
+    ft_free(names);
+
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include <elf.h>
+#include <libft/stdio.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <time.h>
+
+#include "ft_nm.h"
+
+// Decodes the type letter of a synthetic symbol table twice: once the way
+// symbol_get_type() used to, looking up the section header, its name in the
+// COFF table and its flags for every symbol, once through the per-section
+// table the decoder now builds up front, and checks both agree before
+// reporting throughput.
+
+#define DEFAULT_SYMBOLS 4000000
+
+struct bench_section {
+    const char *name;
+    unsigned int type;
+    unsigned long flags;
+};
+
+static const struct bench_section sections[] = {
+    {"", SHT_NULL, 0},
+    {".text", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR},
+    {".text.unlikely", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR},
+    {".text.hot", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR},
+    {".init", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR},
+    {".fini", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR},
+    {".rodata", SHT_PROGBITS, SHF_ALLOC},
+    {".rodata.str1.1", SHT_PROGBITS, SHF_ALLOC | SHF_MERGE | SHF_STRINGS},
+    {".data", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE},
+    {".data.rel.ro", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE},
+    {".bss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE},
+    {".tbss", SHT_NOBITS, SHF_ALLOC | SHF_WRITE | SHF_TLS},
+    {".tdata", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE | SHF_TLS},
+    {".init_array", SHT_INIT_ARRAY, SHF_ALLOC | SHF_WRITE},
+    {".fini_array", SHT_FINI_ARRAY, SHF_ALLOC | SHF_WRITE},
+    {".eh_frame", SHT_PROGBITS, SHF_ALLOC},
+    {".gcc_except_table", SHT_PROGBITS, SHF_ALLOC},
+    {".note.GNU-stack", SHT_PROGBITS, 0},
+    {".comment", SHT_PROGBITS, SHF_MERGE | SHF_STRINGS},
+    {".debug_info", SHT_PROGBITS, 0},
+    {".debug_str", SHT_PROGBITS, SHF_MERGE | SHF_STRINGS},
+    {".group", SHT_GROUP, 0},
+    {"__libc_freeres_fn", SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR},
+    {"__libc_subfreeres", SHT_PROGBITS, SHF_ALLOC | SHF_WRITE},
+};
+
+#define SECTION_COUNT (sizeof(sections) / sizeof(sections[0]))
+
+static unsigned long rng_state = 0x2545F4914F6CDD1DUL;
+
+static unsigned long rng(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Section names live in `str` at the offsets the headers point to.
+static void make_sections(Elf64_Shdr *shdr, char *str) {
+    size_t offset = 1;
+
+    str[0] = '\0';
+
+    for (size_t i = 0; i < SECTION_COUNT; i++) {
+        size_t len = ft_strlen(sections[i].name);
+
+        ft_bzero(&shdr[i], sizeof(Elf64_Shdr));
+        ft_memcpy(str + offset, sections[i].name, len + 1);
+        shdr[i].sh_name = offset;
+        shdr[i].sh_type = sections[i].type;
+        shdr[i].sh_flags = sections[i].flags;
+        shdr[i].sh_offset = i ? 0x40 * i : 0;
+        offset += len + 1;
+    }
+}
+
+// Mostly global and local functions and objects, with weak, undefined,
+// common, absolute and IFUNC symbols mixed in.
+static void make_symbols(Elf64_Sym *sym, size_t count) {
+    static const unsigned char binds[] = {STB_GLOBAL, STB_GLOBAL, STB_GLOBAL, STB_LOCAL, STB_LOCAL, STB_WEAK, STB_GNU_UNIQUE};
+    static const unsigned char types[] = {STT_FUNC, STT_FUNC, STT_OBJECT, STT_OBJECT, STT_NOTYPE, STT_TLS, STT_GNU_IFUNC};
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned long r = rng();
+
+        ft_bzero(&sym[i], sizeof(Elf64_Sym));
+        sym[i].st_info = ELF64_ST_INFO(binds[r % sizeof(binds)], types[(r >> 8) % sizeof(types)]);
+        sym[i].st_shndx = 1 + (r >> 16) % (SECTION_COUNT - 1);
+
+        if ((r >> 32) % 16 == 0) {
+            sym[i].st_shndx = SHN_UNDEF;
+        } else if ((r >> 32) % 64 == 1) {
+            sym[i].st_shndx = SHN_COMMON;
+        } else if ((r >> 32) % 64 == 2) {
+            sym[i].st_shndx = SHN_ABS;
+        }
+    }
+}
+
+static char undefined_type(const Elf64_Sym *sym) {
+    if (ELF64_ST_BIND(sym->st_info) != STB_WEAK) {
+        return 'U';
+    }
+
+    return ELF64_ST_TYPE(sym->st_info) == STT_OBJECT ? 'v' : 'w';
+}
+
+// The per-symbol path the decoder used to take for every symbol.
+static char legacy_type(const Elf64_Shdr *shdr, const char *str, const Elf64_Sym *sym) {
+    char c = 0;
+
+    if (sym->st_shndx == SHN_COMMON) {
+        return 'C';
+    }
+
+    if (sym->st_shndx == SHN_UNDEF) {
+        return undefined_type(sym);
+    }
+
+    if (ELF64_ST_TYPE(sym->st_info) == STT_GNU_IFUNC) {
+        return 'i';
+    }
+
+    if (ELF64_ST_BIND(sym->st_info) == STB_WEAK) {
+        return ELF64_ST_TYPE(sym->st_info) == STT_OBJECT ? 'V' : 'W';
+    }
+
+    if (ELF64_ST_BIND(sym->st_info) != STB_GLOBAL && ELF64_ST_BIND(sym->st_info) != STB_LOCAL) {
+        return 'u';
+    }
+
+    if (sym->st_shndx != SHN_ABS) {
+        const Elf64_Shdr *header = &shdr[sym->st_shndx];
+
+        c = section_name_type(str + header->sh_name);
+
+        if (c == '?') {
+            c = ELF64_ST_TYPE(sym->st_info) == STT_FUNC ? 't' : section_flags_type(header->sh_type, header->sh_flags, header->sh_offset);
+        }
+    }
+
+    if (ELF64_ST_BIND(sym->st_info) == STB_GLOBAL && c >= 'a' && c <= 'z') {
+        c -= 'a' - 'A';
+    }
+
+    return c;
+}
+
+static char table_type(const unsigned char *table, const Elf64_Sym *sym) {
+    if (sym->st_shndx == SHN_COMMON) {
+        return 'C';
+    }
+
+    if (sym->st_shndx == SHN_UNDEF) {
+        return undefined_type(sym);
+    }
+
+    if (sym->st_shndx < SECTION_COUNT) {
+        return symbol_class_type(table, sym->st_info, sym->st_shndx);
+    }
+
+    return info_types[sym->st_info] & ~INFO_UPPER;
+}
+
+int main(int argc, char **argv) {
+    size_t count = argc > 1 ? (size_t) ft_atoi(argv[1]) : DEFAULT_SYMBOLS;
+    Elf64_Sym *sym = ft_malloc(count * sizeof(Elf64_Sym));
+    char *before = ft_malloc(count), *after = ft_malloc(count), str[1024];
+    Elf64_Shdr shdr[SECTION_COUNT];
+    unsigned char table[SECTION_COUNT];
+
+    if (!sym || !before || !after) {
+        return 1;
+    }
+
+    make_sections(shdr, str);
+    make_symbols(sym, count);
+
+    double start = now();
+
+    for (size_t i = 0; i < count; i++) {
+        before[i] = legacy_type(shdr, str, &sym[i]);
+    }
+
+    double legacy_time = now() - start;
+
+    // The table is part of the cost: it is rebuilt for every file.
+    start = now();
+
+    for (size_t i = 0; i < SECTION_COUNT; i++) {
+        table[i] = section_class(str + shdr[i].sh_name, shdr[i].sh_type, shdr[i].sh_flags, shdr[i].sh_offset);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        after[i] = table_type(table, &sym[i]);
+    }
+
+    double table_time = now() - start;
+
+    for (size_t i = 0; i < count; i++) {
+        if (before[i] != after[i]) {
+            ft_dprintf(2, "type_bench: types differ at %lu: '%c' != '%c'\n", i, before[i], after[i]);
+            return 1;
+        }
+    }
+
+    ft_printf("symbols:                %lu in %lu sections\n", count, SECTION_COUNT);
+    ft_printf("per-symbol lookup:      %d ms (%d Ksym/s)\n", (int) (legacy_time * 1000), (int) (count / legacy_time / 1000));
+    ft_printf("section table lookup:   %d ms (%d Ksym/s)\n", (int) (table_time * 1000), (int) (count / table_time / 1000));
+
+    ft_free(sym);
+    ft_free(before);
+    ft_free(after);
+
+    return 0;
+}
@@ -2,11 +2,17 @@
 
 #define ERR_NO_SYMS 1
 #define ERR_NO_MEM  2
+#define ERR_MISSING 3
+#define ERR_IO      4
 
+#include <ar.h>
 #include <elf.h>
+#include <libft/stdbool.h>
 #include <libft/stdlib.h>
-#include <libft/stl/list.h>
+#include <regex.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <time.h>
 
 #define INVCL  -2
 #define NOTELF -1
@@ -15,35 +21,584 @@
 #define ELF32  32
 #define ELF64  64
 
-#define FLAG_DEBUG_SYMBOLS  0b10000
-#define FLAG_EXTERN_ONLY    0b01000
-#define FLAG_NO_SORT        0b00100
-#define FLAG_REV_SORT       0b00010
-#define FLAG_UNDEFINED_ONLY 0b00001
+#define FLAG_PRINT_SIZE     0b10000000000
+#define FLAG_SIZE_SORT      0b01000000000
+#define FLAG_NUMERIC_SORT   0b00100000000
+#define FLAG_DEMANGLE_SORT  0b10000000
+#define FLAG_DEMANGLE       0b01000000
+#define FLAG_DYNAMIC        0b00100000
+#define FLAG_DEBUG_SYMBOLS  0b00010000
+#define FLAG_EXTERN_ONLY    0b00001000
+#define FLAG_NO_SORT        0b00000100
+#define FLAG_REV_SORT       0b00000010
+#define FLAG_UNDEFINED_ONLY 0b00000001
+
+// High bits of the type tables: section_class() marks sections whose
+// function symbols print as 't', info_types[] marks global bindings.
+#define SECTION_FUNC 0x80
+#define INFO_UPPER   0x80
+
+#define NM_CACHE_DEFAULT_SIZE (256UL << 20)
+
+#define STATS_OFF  0
+#define STATS_TEXT 1
+#define STATS_JSON 2
+
+#define FORMAT_TEXT  0
+#define FORMAT_JSONL 1
+#define FORMAT_BIN   2
+
+#define WATCH_OFF     0
+#define WATCH_FULL    1
+#define WATCH_CHANGES 2
+
+#define LABEL_FILE   1
+#define LABEL_MEMBER 2
+
+#define FILTER_BIND_LOCAL  0b001
+#define FILTER_BIND_GLOBAL 0b010
+#define FILTER_BIND_WEAK   0b100
+
+#define PATTERN_GLOB  0
+#define PATTERN_REGEX 1
+
+enum nm_phase {
+    PHASE_MAP,
+    PHASE_SCAN,
+    PHASE_DECODE,
+    PHASE_SORT,
+    PHASE_PRINT,
+    PHASE_COUNT,
+};
+
+// An fd < 0 keeps the output in memory until its owner drains it.
+struct nm_output {
+    char *data;
+    size_t len;
+    size_t cap;
+    int fd;
+};
 
 struct symbol_entry {
-    struct list_head list;
+    unsigned long key;
     unsigned long st_value;
+    unsigned long st_size;
     char *st_name;
+    unsigned int st_name_len;
+    unsigned short st_shndx;
     char type;
 };
 
-#define swap16(number, endian) ((endian) == ELFDATA2MSB ? __builtin_bswap16(number) : (number))
-#define swap32(number, endian) ((endian) == ELFDATA2MSB ? __builtin_bswap32(number) : (number))
-#define swap64(number, endian) ((endian) == ELFDATA2MSB ? __builtin_bswap64(number) : (number))
+// `strings` is the string table most names point into, when there is one.
+struct symbol_table {
+    struct symbol_entry *entries;
+    struct symbol_entry *scratch;
+    size_t count;
+    size_t cap;
+    unsigned char *sections;
+    size_t sections_cap;
+    const char *strings;
+    size_t strings_size;
+};
+
+// --format=bin is a stream of frames in host byte order. A label frame
+// (LABEL_FILE or LABEL_MEMBER) is followed by `strings_size` bytes of name; a
+// BIN_SYMBOLS frame by `count` records and then `strings_size` bytes of names
+// the records point into, NUL separated or not.
+#define BIN_SYMBOLS 3
+
+struct nm_bin_frame {
+    unsigned int kind;
+    unsigned int count;
+    unsigned long strings_size;
+};
+
+struct nm_bin_record {
+    unsigned long value;
+    unsigned long size;
+    unsigned long name_off;
+    unsigned int name_len;
+    unsigned short shndx;
+    char type;
+    char reserved;
+};
+
+struct armap_entry {
+    const char *name;
+    unsigned int name_len;
+    unsigned int hash;
+    size_t member;
+};
+
+struct armap {
+    struct armap_entry *slots;
+    size_t mask;
+    size_t count;
+};
+
+struct lookup_member {
+    unsigned char *data;
+    size_t size;
+    char *name;
+    size_t name_len;
+};
+
+struct file_list {
+    char **files;
+    size_t count;
+    size_t cap;
+};
+
+// A --match or --regex pattern. `prefix` is literal text every matching name
+// starts with, checked before the pattern itself; a glob without wildcards
+// is `literal` and needs nothing more.
+struct nm_pattern {
+    int kind;
+    const char *source;
+    const char *prefix;
+    size_t prefix_len;
+    bool literal;
+    regex_t regex;
+};
+
+// What the decoder keeps besides -g and -u; `types` is indexed by type letter.
+struct nm_filter {
+    bool active;
+    bool defined_only;
+    int binds;
+    bool typed;
+    bool types[256];
+    struct file_list sections;
+    struct file_list globs;
+    struct file_list regexes;
+    struct nm_pattern *patterns;
+    size_t pattern_count;
+};
+
+struct nm_options {
+    int flags;
+    int threads;
+    char **lookup;
+    size_t lookup_count;
+    bool lookup_details;
+    char *cache_dir;
+    size_t cache_size;
+    bool cache_stats;
+    char *files_from;
+    bool null_separated;
+    bool server;
+    int stats;
+    int format;
+    bool diff;
+    int watch;
+    size_t top;
+    bool top_merged;
+    size_t memory_limit;
+    struct nm_filter filter;
+    struct file_list has;
+    struct file_list recursive;
+    struct file_list args;
+    struct file_list response_words;
+};
+
+struct cache_key {
+    unsigned long dev;
+    unsigned long ino;
+    unsigned long size;
+    unsigned long mtime_sec;
+    unsigned long mtime_nsec;
+    unsigned long header_hash;
+    unsigned long flags;
+};
+
+struct cache_stats {
+    size_t hits;
+    size_t misses;
+    size_t stores;
+    size_t evictions;
+};
+
+// Symbol tables captured in printed order while a file is parsed, so they can
+// be written to the cache once the whole file has succeeded.
+struct cache_writer {
+    struct nm_output blocks;
+    struct nm_output records;
+    struct nm_output strings;
+    size_t block_count;
+    size_t record_count;
+    bool open_block;
+};
+
+struct nm_stats {
+    unsigned long phase_ns[PHASE_COUNT];
+    size_t files;
+    size_t symbols_seen;
+    size_t skipped_file;
+    size_t skipped_name;
+    size_t skipped_type;
+    size_t skipped_filter;
+    size_t allocated;
+    size_t printed;
+    size_t bytes_mapped;
+    unsigned long minor_faults;
+    unsigned long major_faults;
+};
+
+struct record_reader {
+    int fd;
+    char *data;
+    size_t len;
+    size_t cap;
+    size_t pos;
+    bool eof;
+};
+
+// An input read instead of mapped. `mem` is an anonymous mapping laid out like
+// the file, filled either whole or only at the ranges the decoder needs.
+struct nm_stream {
+    int fd;
+    bool seekable;
+    bool sequential;
+    unsigned char *mem;
+    size_t size;
+    size_t cap;
+    size_t pos;
+    size_t fetched;
+};
+
+struct worker_pool;
+
+struct nm_cache;
+
+struct demangle_cache;
+
+struct top_merge;
+
+struct nm_spill;
+
+struct nm_context {
+    const struct nm_options *opts;
+    int flags;
+    struct nm_output out;
+    struct nm_output err;
+    struct symbol_table symbols;
+    struct worker_pool *pool;
+    struct nm_cache *cache;
+    struct demangle_cache *demangle;
+    struct top_merge *top;
+    struct nm_spill *spill;
+    struct cache_writer capture;
+    bool capturing;
+    size_t errors;
+    struct nm_stats stats;
+    struct nm_stats stats_total;
+};
+
+typedef int (*pool_job_t)(struct nm_context *ctx, void *arg, size_t index);
+
+// `offset` is where the member header sits in the archive.
+struct archive_member {
+    struct ar_hdr *header;
+    size_t offset;
+    unsigned char *data;
+    size_t size;
+    char *name;
+    size_t name_len;
+    int class;
+};
+
+struct archive_index {
+    struct archive_member *members;
+    size_t count;
+    size_t cap;
+    bool truncated;
+};
+
+extern const unsigned char info_types[256];
+
+// Type of a defined symbol from the section table built by the decoder and
+// the st_info table, without touching the section header.
+static inline char symbol_class_type(const unsigned char *sections, unsigned char info, size_t shndx) {
+    unsigned char fixed = info_types[info], type = sections[shndx];
+
+    if (fixed & ~INFO_UPPER) {
+        return fixed;
+    }
+
+    if (type & SECTION_FUNC) {
+        type = ELF64_ST_TYPE(info) == STT_FUNC ? 't' : type & ~SECTION_FUNC;
+    }
+
+    return fixed && type >= 'a' && type <= 'z' ? type - ('a' - 'A') : type;
+}
+
+static inline unsigned long symbol_key(const char *name, size_t len) {
+    unsigned long key = 0;
+
+    if (len >= 8) {
+        __builtin_memcpy(&key, name, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        key = __builtin_bswap64(key);
+#endif
+        return key;
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        key = key << 8 | (i < len ? (unsigned char) name[i] : 0);
+    }
+
+    return key;
+}
+
+static inline unsigned long hash_bytes(const void *data, size_t len) {
+    const unsigned char *bytes = data;
+    unsigned long hash = 0xcbf29ce484222325UL;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3UL;
+    }
+
+    return hash;
+}
+
+// Phase timers cost one well-predicted branch when --stats is off.
+static inline unsigned long stats_clock(const struct nm_context *ctx) {
+    struct timespec ts;
+
+    if (!ctx->opts->stats) {
+        return 0;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec * 1000000000UL + ts.tv_nsec;
+}
+
+// Charges the time since `start` to `phase` and returns the new start.
+static inline unsigned long stats_lap(struct nm_context *ctx, enum nm_phase phase, unsigned long start) {
+    unsigned long now = stats_clock(ctx);
+
+    ctx->stats.phase_ns[phase] += now - start;
+
+    return now;
+}
 
 #define ptr_in(ptr, mem, size)             ((void *) ptr >= (void *) mem && (void *) ptr <= (void *) mem + size)
 #define ptr_in_strict(ptr, min, mem, size) ((void *) ptr >= (void *) mem && (void *) ptr <= (void *) mem + size && (void *) ptr + min <= (void *) mem + size)
 #define ptr_max_size(ptr, mem, size)       (((void *) ptr >= (void *) mem && (void *) ptr <= (void *) mem + size) ? (void *) mem + size - (void *) ptr : 0)
 
-int parse_elf_64(unsigned char *mem, size_t size, int flags);
+int parse_elf_64(struct nm_context *ctx, unsigned char *mem, size_t size);
+
+int parse_elf_32(struct nm_context *ctx, unsigned char *mem, size_t size);
+
+int parse_archive(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size);
 
-int parse_elf_32(unsigned char *mem, size_t size, int flags);
+char *archive_member_name(char *name, char *funcs, size_t *len);
 
-int parse_archive(const char *file, unsigned char *mem, size_t size, int flags);
+bool archive_member_size(const struct ar_hdr *hdr, size_t *size);
+
+char *archive_long_names(unsigned char *mem, size_t size);
+
+int archive_index_build(struct archive_index *index, unsigned char *mem, size_t size);
+
+void archive_index_free(struct archive_index *index);
+
+int archive_parse_member(struct nm_context *ctx, struct archive_member *member);
 
 int parse_magic(char *ptr, size_t size);
 
-void print_symbols(struct list_head *symbol_list);
+int armap_load(struct armap *map, unsigned char *mem, size_t size);
+
+const struct armap_entry *armap_find(const struct armap *map, const char *name, size_t len, const struct armap_entry *prev);
+
+void armap_free(struct armap *map);
+
+int load_elf(struct nm_context *ctx, unsigned char *mem, size_t size);
+
+int load_table(struct nm_context *ctx, unsigned char *mem, size_t size);
+
+char section_name_type(const char *name);
+
+char section_flags_type(unsigned int sh_type, unsigned long sh_flags, unsigned long sh_offset);
+
+unsigned char section_class(const char *name, unsigned int sh_type, unsigned long sh_flags, unsigned long sh_offset);
+
+int stream_elf_ranges(struct nm_stream *stream);
+
+bool lookup_resolve(unsigned char *mem, size_t size, char *long_names, size_t offset, struct lookup_member *member);
+
+int lookup_symbols(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size);
+
+int has_dynamic(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size);
+
+bool has_report(struct nm_context *ctx, const char *file, const char *member, size_t member_len, const char *name, char type);
+
+int has_symbols(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size);
+
+void print_symbol(struct nm_context *ctx, const struct symbol_entry *entry);
+
+void print_symbols(struct nm_context *ctx, struct symbol_table *table);
+
+bool symbol_selected(const struct nm_context *ctx, const struct symbol_entry *entry);
+
+void emit_label(struct nm_context *ctx, int kind, const char *label, size_t len);
+
+int parse_files(struct nm_context *ctx, char **files, size_t count);
+
+void symbol_table_init(struct symbol_table *table);
+
+int symbol_table_reset(struct symbol_table *table, size_t count);
+
+void strings_init(void);
+
+size_t str_len(const char *s);
+
+size_t str_nlen(const char *s, size_t max);
+
+size_t str_mismatch(const char *a, const char *b, size_t len);
+
+int str_compare(const char *a, size_t a_len, const char *b, size_t b_len);
+
+unsigned char *symbol_table_sections(struct symbol_table *table, size_t count);
+
+int symbol_table_sort(struct symbol_table *table, int flags);
+
+int symbol_compare(const struct symbol_entry *lhs, const struct symbol_entry *rhs, int flags);
+
+void symbol_table_free(struct symbol_table *table);
+
+const char *demangle_name(struct nm_context *ctx, const char *name, size_t len, size_t *out_len);
+
+void demangle_table(struct nm_context *ctx, struct symbol_table *table);
+
+void demangle_free(struct demangle_cache *cache);
+
+void output_init(struct nm_output *out, int fd);
+
+char *output_claim(struct nm_output *out, size_t len);
+
+int output_append(struct nm_output *out, const char *data, size_t len);
+
+int output_printf(struct nm_output *out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+int output_flush(struct nm_output *out);
+
+void output_hex64(char *dst, unsigned long value);
+
+void output_reset(struct nm_output *out);
+
+int output_json_string(struct nm_output *out, const char *str, size_t len);
+
+int output_direct(struct nm_output *out, const char *data, size_t len);
+
+void output_free(struct nm_output *out);
+
+int options_parse(struct nm_options *opts, int *argc, char ***argv);
+
+void options_free(struct nm_options *opts);
+
+void context_init(struct nm_context *ctx, const struct nm_options *opts, int out_fd, int err_fd);
+
+void context_fork(const struct nm_context *parent, struct nm_context *child);
+
+void context_error(struct nm_context *ctx, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+void context_flush_err(struct nm_context *ctx);
+
+void context_free(struct nm_context *ctx);
+
+struct worker_pool *pool_create(size_t thread_count);
+
+int pool_run(struct worker_pool *pool, struct nm_context *parent, size_t count, pool_job_t run, void *arg);
+
+void pool_destroy(struct worker_pool *pool);
+
+void reader_init(struct record_reader *reader, int fd);
+
+char *reader_next(struct record_reader *reader, const char *delim, size_t delim_len, size_t *len);
+
+void reader_free(struct record_reader *reader);
+
+int file_list_push(struct file_list *list, char *file);
+
+int file_list_read(struct file_list *list, const char *path, char delim);
+
+void file_list_free(struct file_list *list, size_t owned_from);
+
+int server_run(struct nm_context *ctx);
+
+size_t diff_symbols(struct nm_context *ctx, const struct symbol_table *old, const struct symbol_table *new, const char *label, size_t label_len);
+
+int diff_files(struct nm_context *ctx, const char *old_file, const char *new_file);
+
+int watch_files(struct nm_context *ctx, char **paths, size_t count);
+
+void top_offer(struct nm_context *ctx, struct symbol_table *table, size_t limit);
+
+void top_finish(struct nm_context *ctx, struct symbol_table *table);
+
+int top_begin(struct nm_context *ctx);
+
+int top_member(struct nm_context *ctx, const struct archive_member *member);
+
+void top_end(struct nm_context *ctx);
+
+int spill_begin(struct nm_context *ctx);
+
+size_t spill_capacity(const struct nm_context *ctx, size_t entries);
+
+bool spill_pending(const struct nm_context *ctx);
+
+int spill_run(struct nm_context *ctx, struct symbol_table *table);
+
+int spill_merge(struct nm_context *ctx);
+
+void spill_end(struct nm_context *ctx);
+
+int filter_compile(struct nm_filter *filter);
+
+void filter_free(struct nm_filter *filter);
+
+bool filter_enabled(const struct nm_context *ctx);
+
+bool filter_symbol(const struct nm_context *ctx, const struct symbol_entry *entry, unsigned char bind, const char *section);
+
+int walk_paths(struct nm_context *ctx, const struct file_list *roots, struct file_list *files);
+
+int stream_open(struct nm_context *ctx, struct nm_stream *stream, int fd, const struct stat *st);
+
+int stream_fetch(struct nm_stream *stream, size_t offset, size_t len);
+
+int stream_archive(struct nm_context *ctx, struct nm_stream *stream);
+
+void stream_close(struct nm_stream *stream);
+
+void stats_merge(struct nm_stats *dst, const struct nm_stats *src);
+
+void stats_begin(struct nm_context *ctx);
+
+void stats_end(struct nm_context *ctx, const char *file);
+
+void stats_finish(struct nm_stats *total);
+
+void stats_report(struct nm_output *out, int format, const char *file, const struct nm_stats *stats, unsigned long wall_ns);
+
+struct nm_cache *cache_open(const char *dir, size_t limit);
+
+bool cache_replay(struct nm_context *ctx, int fd, const struct stat *st, const char *label, struct cache_key *key);
+
+void cache_store(struct nm_context *ctx, const struct cache_key *key, struct cache_writer *writer);
+
+struct cache_stats cache_get_stats(struct nm_cache *cache);
+
+void cache_close(struct nm_cache *cache);
+
+void cache_writer_init(struct cache_writer *writer);
+
+void cache_writer_block(struct cache_writer *writer, const char *label, size_t len);
+
+void cache_writer_symbols(struct cache_writer *writer, const struct symbol_table *table);
+
+void cache_writer_merge(struct cache_writer *parent, struct cache_writer *child);
 
-void free_symbols(struct list_head *symbol_list);
\ No newline at end of file
+void cache_writer_free(struct cache_writer *writer);
\ No newline at end of file
@@ -0,0 +1,346 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <libft/ctype.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+#define READER_MIN_CAP 4096
+
+void reader_init(struct record_reader *reader, int fd) {
+    reader->fd = fd;
+    reader->data = NULL;
+    reader->len = 0;
+    reader->cap = 0;
+    reader->pos = 0;
+    reader->eof = false;
+}
+
+static int reader_fill(struct record_reader *reader) {
+    if (reader->pos) {
+        ft_memmove(reader->data, reader->data + reader->pos, reader->len - reader->pos);
+        reader->len -= reader->pos;
+        reader->pos = 0;
+    }
+
+    if (reader->len == reader->cap) {
+        size_t cap = reader->cap ? reader->cap * 2 : READER_MIN_CAP;
+        char *data = ft_malloc(cap + 1);
+
+        if (!data) {
+            return ERR_NO_MEM;
+        }
+
+        if (reader->data) {
+            ft_memcpy(data, reader->data, reader->len);
+            ft_free(reader->data);
+        }
+
+        reader->data = data;
+        reader->cap = cap;
+    }
+
+    ssize_t ret;
+
+    while ((ret = read(reader->fd, reader->data + reader->len, reader->cap - reader->len)) < 0 && errno == EINTR) {
+    }
+
+    if (ret <= 0) {
+        reader->eof = true;
+    } else {
+        reader->len += ret;
+    }
+
+    return 0;
+}
+
+static char *reader_find(struct record_reader *reader, const char *delim, size_t delim_len) {
+    char *iter = reader->data + reader->pos, *end = reader->data + reader->len;
+
+    while (reader->data && (iter = ft_memchr(iter, delim[0], end - iter))) {
+        if ((size_t) (end - iter) < delim_len) {
+            return NULL;
+        }
+
+        if (!ft_memcmp(iter, delim, delim_len)) {
+            return iter;
+        }
+
+        iter++;
+    }
+
+    return NULL;
+}
+
+// Returns the next record terminated by the `delim_len` bytes at `delim`,
+// NUL-terminated in place, or NULL at the end of input. A final record
+// without a terminator still counts. The pointer stays valid until the next
+// call.
+char *reader_next(struct record_reader *reader, const char *delim, size_t delim_len, size_t *len) {
+    while (true) {
+        char *start = reader->data + reader->pos, *end = reader_find(reader, delim, delim_len);
+
+        if (end || (reader->eof && reader->pos < reader->len)) {
+            size_t skip = end ? delim_len : 0;
+
+            if (!end) {
+                end = reader->data + reader->len;
+            }
+
+            *end = '\0';
+            *len = end - start;
+            reader->pos = end - reader->data + skip;
+
+            return start;
+        }
+
+        if (reader->eof || reader_fill(reader)) {
+            return NULL;
+        }
+    }
+}
+
+void reader_free(struct record_reader *reader) {
+    ft_free(reader->data);
+    reader_init(reader, -1);
+}
+
+int file_list_push(struct file_list *list, char *file) {
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        char **files = ft_malloc(cap * sizeof(char *));
+
+        if (!files) {
+            return ERR_NO_MEM;
+        }
+
+        if (list->files) {
+            ft_memcpy(files, list->files, list->count * sizeof(char *));
+            ft_free(list->files);
+        }
+
+        list->files = files;
+        list->cap = cap;
+    }
+
+    list->files[list->count++] = file;
+
+    return 0;
+}
+
+// Appends every non-empty `delim`-separated entry of `path` ("-" for stdin).
+int file_list_read(struct file_list *list, const char *path, char delim) {
+    bool is_stdin = !ft_strcmp(path, "-");
+    int fd = is_stdin ? STDIN_FILENO : open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return 1;
+    }
+
+    struct record_reader reader;
+    char *record;
+    size_t len;
+    int err = 0;
+
+    reader_init(&reader, fd);
+
+    while (!err && (record = reader_next(&reader, &delim, 1, &len))) {
+        if (len && delim == '\n' && record[len - 1] == '\r') {
+            record[--len] = '\0';
+        }
+
+        if (!len) {
+            continue;
+        }
+
+        char *file = ft_strndup(record, len);
+
+        if (!file || file_list_push(list, file)) {
+            ft_free(file);
+            err = ERR_NO_MEM;
+        }
+    }
+
+    reader_free(&reader);
+
+    if (!is_stdin) {
+        close(fd);
+    }
+
+    return err;
+}
+
+void file_list_free(struct file_list *list, size_t owned_from) {
+    for (size_t i = owned_from; i < list->count; i++) {
+        ft_free(list->files[i]);
+    }
+
+    ft_free(list->files);
+    list->files = NULL;
+    list->count = 0;
+    list->cap = 0;
+}
+
+// Applies a request's "-aCDgnprSuv" style words to `flags`; returns the offending
+// character on error.
+static int server_flags(const char *word, int *flags) {
+    for (const char *iter = word + 1; *iter; iter++) {
+        switch (*iter) {
+            case 'a':
+                *flags |= FLAG_DEBUG_SYMBOLS;
+                break;
+            case 'C':
+                *flags |= FLAG_DEMANGLE;
+                break;
+            case 'D':
+                *flags |= FLAG_DYNAMIC;
+                break;
+            case 'g':
+                *flags |= FLAG_EXTERN_ONLY;
+                break;
+            case 'u':
+                *flags |= FLAG_UNDEFINED_ONLY;
+                break;
+            case 'n':
+            case 'v':
+                *flags |= FLAG_NUMERIC_SORT;
+                break;
+            case 'S':
+                *flags |= FLAG_PRINT_SIZE;
+                break;
+            case 'p':
+                *flags |= FLAG_NO_SORT;
+                break;
+            case 'r':
+                *flags |= FLAG_REV_SORT;
+                break;
+            default:
+                return *iter;
+        }
+    }
+
+    return 0;
+}
+
+// Splits one request into words: whitespace separated when requests are
+// lines, NUL separated (ending with an empty field) when they are not.
+static int server_words(struct file_list *words, char *request, size_t len, bool null) {
+    char *iter = request, *end = request + len;
+
+    words->count = 0;
+
+    while (iter < end) {
+        if (!null) {
+            while (iter < end && ft_isspace(*iter)) {
+                *iter++ = '\0';
+            }
+
+            if (iter == end) {
+                break;
+            }
+        }
+
+        if (file_list_push(words, iter)) {
+            return ERR_NO_MEM;
+        }
+
+        while (iter < end && (null ? *iter : !ft_isspace(*iter))) {
+            iter++;
+        }
+
+        if (null) {
+            iter++;
+        }
+    }
+
+    return 0;
+}
+
+static int server_request(struct nm_context *ctx, struct file_list *words) {
+    int flags = ctx->opts->flags;
+    size_t first = 0;
+
+    for (; first < words->count && words->files[first][0] == '-' && words->files[first][1]; first++) {
+        if (!ft_strcmp(words->files[first], "--")) {
+            first++;
+            break;
+        }
+
+        int bad = server_flags(words->files[first], &flags);
+
+        if (bad) {
+            context_error(ctx, "ft_nm: invalid option -- '%c'\n", bad);
+            return 1;
+        }
+    }
+
+    if (flags & FLAG_NO_SORT && flags & FLAG_REV_SORT) {
+        context_error(ctx, "ft_nm: conflicting options -p and -r\n");
+        return 1;
+    }
+
+    // Standard input carries the requests themselves.
+    for (size_t i = first; i < words->count; i++) {
+        if (!ft_strcmp(words->files[i], "-")) {
+            context_error(ctx, "ft_nm: -: standard input is not available in server mode\n");
+            return 1;
+        }
+    }
+
+    ctx->flags = flags;
+
+    static char *default_file[] = {"a.out"};
+    size_t count = words->count - first;
+
+    return parse_files(ctx, count ? words->files + first : default_file, count ? count : 1);
+}
+
+// Serves requests from stdin until it is closed. Each request is a line (or,
+// with --null, a run of NUL-terminated fields ending with an empty one) of
+// per-request flags followed by files, answered on stdout by a frame:
+//
+//   "<status> <stdout bytes> <stderr bytes>\n" <stdout bytes> <stderr bytes>
+//
+// The context, its symbol arena, its buffers, the worker pool and the cache
+// all live across requests.
+int server_run(struct nm_context *ctx) {
+    struct record_reader reader;
+    struct file_list words = {0};
+    struct nm_output frame;
+    bool null = ctx->opts->null_separated;
+    char *request;
+    size_t len;
+    int err = 0;
+
+    reader_init(&reader, STDIN_FILENO);
+    output_init(&frame, STDOUT_FILENO);
+
+    while (!err && (request = reader_next(&reader, null ? "\0" : "\n", null ? 2 : 1, &len))) {
+        if ((err = server_words(&words, request, len, null))) {
+            break;
+        }
+
+        if (!words.count) {
+            continue;
+        }
+
+        ctx->errors = 0;
+
+        int status = server_request(ctx, &words);
+
+        output_printf(&frame, "%d %zu %zu\n", status, ctx->out.len, ctx->err.len);
+        output_append(&frame, ctx->out.data, ctx->out.len);
+        output_append(&frame, ctx->err.data, ctx->err.len);
+        output_flush(&frame);
+        output_reset(&ctx->out);
+        output_reset(&ctx->err);
+    }
+
+    file_list_free(&words, words.count);
+    reader_free(&reader);
+    output_free(&frame);
+
+    return err;
+}
@@ -0,0 +1,547 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libft/stdio.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+// On-disk layout of a cache entry, mapped read-only on a hit:
+//
+//   struct cache_header
+//   struct cache_block   [block_count]   one per ELF file / archive member
+//   struct cache_record  [record_count]  symbols in printed order
+//   char                 [strings_size]  member labels and symbol names
+//
+// The key fields are repeated in the header so a hash collision is caught.
+
+#define CACHE_MAGIC     "FTNMCACH"
+#define CACHE_VERSION   2
+#define CACHE_SUFFIX    ".nmc"
+#define CACHE_HEAD_SIZE 64
+
+struct cache_header {
+    char magic[8];
+    unsigned long version;
+    struct cache_key key;
+    unsigned long block_count;
+    unsigned long record_count;
+    unsigned long strings_size;
+};
+
+struct cache_block {
+    unsigned long label_off;
+    unsigned long label_len;
+    unsigned long record_start;
+    unsigned long record_count;
+    unsigned long has_label;
+};
+
+struct cache_record {
+    unsigned long value;
+    unsigned long size;
+    unsigned long name_off;
+    unsigned int name_len;
+    unsigned short shndx;
+    char type;
+};
+
+struct nm_cache {
+    char *dir;
+    size_t limit;
+    size_t total;
+    pthread_mutex_t lock;
+    struct cache_stats stats;
+};
+
+struct cache_file {
+    char *path;
+    size_t size;
+    struct timespec mtime;
+};
+
+struct nm_cache *cache_open(const char *dir, size_t limit) {
+    struct nm_cache *cache = ft_malloc(sizeof(struct nm_cache));
+
+    if (!cache) {
+        return NULL;
+    }
+
+    if (mkdir(dir, 0755) < 0 && errno != EEXIST) {
+        ft_dprintf(STDERR_FILENO, "ft_nm: %s: unable to create cache directory\n", dir);
+        ft_free(cache);
+        return NULL;
+    }
+
+    cache->dir = ft_strdup(dir);
+    cache->limit = limit;
+    cache->total = 0;
+    ft_bzero(&cache->stats, sizeof(cache->stats));
+    pthread_mutex_init(&cache->lock, NULL);
+
+    DIR *handle = opendir(dir);
+    struct dirent *ent;
+
+    while (handle && (ent = readdir(handle))) {
+        struct stat st;
+        size_t len = ft_strlen(ent->d_name);
+
+        if (len > 4 && !ft_strcmp(ent->d_name + len - 4, CACHE_SUFFIX) && !fstatat(dirfd(handle), ent->d_name, &st, 0)) {
+            cache->total += st.st_size;
+        }
+    }
+
+    if (handle) {
+        closedir(handle);
+    }
+
+    return cache;
+}
+
+void cache_close(struct nm_cache *cache) {
+    if (!cache) {
+        return;
+    }
+
+    pthread_mutex_destroy(&cache->lock);
+    ft_free(cache->dir);
+    ft_free(cache);
+}
+
+struct cache_stats cache_get_stats(struct nm_cache *cache) {
+    struct cache_stats stats;
+
+    pthread_mutex_lock(&cache->lock);
+    stats = cache->stats;
+    pthread_mutex_unlock(&cache->lock);
+
+    return stats;
+}
+
+static void cache_count(struct nm_cache *cache, size_t *counter, size_t n) {
+    pthread_mutex_lock(&cache->lock);
+    *counter += n;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static int cache_make_key(struct cache_key *key, int fd, const struct stat *st, int flags) {
+    unsigned char head[CACHE_HEAD_SIZE];
+    ssize_t len = pread(fd, head, sizeof(head), 0);
+
+    // A zero size marks the key as unusable for cache_store().
+    ft_bzero(key, sizeof(*key));
+
+    if (len < 0) {
+        return 1;
+    }
+
+    key->dev = st->st_dev;
+    key->ino = st->st_ino;
+    key->size = st->st_size;
+    key->mtime_sec = st->st_mtim.tv_sec;
+    key->mtime_nsec = st->st_mtim.tv_nsec;
+    key->header_hash = hash_bytes(head, len);
+    // -g and -u drop symbols while decoding, so the table stored depends on
+    // them too; the other filters make a listing uncacheable.
+    key->flags = flags & (FLAG_NO_SORT | FLAG_REV_SORT | FLAG_NUMERIC_SORT | FLAG_SIZE_SORT | FLAG_DYNAMIC | FLAG_DEMANGLE_SORT | FLAG_EXTERN_ONLY | FLAG_UNDEFINED_ONLY);
+
+    return 0;
+}
+
+static char *cache_path(struct nm_cache *cache, const struct cache_key *key, const char *suffix) {
+    size_t len = ft_strlen(cache->dir) + 64;
+    char *path = ft_malloc(len);
+
+    if (path) {
+        snprintf(path, len, "%s/%016lx%s", cache->dir, hash_bytes(key, sizeof(*key)), suffix);
+    }
+
+    return path;
+}
+
+// Checks the whole entry up front, so a hit never prints a partial listing.
+static bool cache_valid(const unsigned char *mem, size_t size, const struct cache_key *key) {
+    const struct cache_header *header = (const struct cache_header *) mem;
+
+    if (size < sizeof(*header) || ft_memcmp(header->magic, CACHE_MAGIC, 8) || header->version != CACHE_VERSION) {
+        return false;
+    }
+
+    if (ft_memcmp(&header->key, key, sizeof(*key))) {
+        return false;
+    }
+
+    if (header->block_count > size || header->record_count > size || header->strings_size > size) {
+        return false;
+    }
+
+    size_t blocks_size = header->block_count * sizeof(struct cache_block),
+           records_size = header->record_count * sizeof(struct cache_record);
+
+    if (sizeof(*header) + blocks_size + records_size + header->strings_size != size) {
+        return false;
+    }
+
+    const struct cache_block *blocks = (const struct cache_block *) (header + 1);
+    const struct cache_record *records = (const struct cache_record *) (blocks + header->block_count);
+
+    for (size_t i = 0; i < header->block_count; i++) {
+        if (blocks[i].record_start > header->record_count
+            || blocks[i].record_count > header->record_count - blocks[i].record_start
+            || blocks[i].label_off > header->strings_size
+            || blocks[i].label_len > header->strings_size - blocks[i].label_off) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < header->record_count; i++) {
+        if (records[i].name_off > header->strings_size || records[i].name_len > header->strings_size - records[i].name_off) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void cache_emit(struct nm_context *ctx, const unsigned char *mem) {
+    const struct cache_header *header = (const struct cache_header *) mem;
+    const struct cache_block *blocks = (const struct cache_block *) (header + 1);
+    const struct cache_record *records = (const struct cache_record *) (blocks + header->block_count);
+    char *strings = (char *) (records + header->record_count);
+
+    for (size_t b = 0; b < header->block_count; b++) {
+        const struct cache_block *block = &blocks[b];
+
+        if (block->has_label) {
+            emit_label(ctx, LABEL_MEMBER, strings + block->label_off, block->label_len);
+        }
+
+        if (symbol_table_reset(&ctx->symbols, block->record_count)) {
+            return;
+        }
+
+        // A block's names were stored back to back.
+        if (block->record_count) {
+            const struct cache_record *first = &records[block->record_start], *last = first + block->record_count - 1;
+
+            ctx->symbols.strings = strings + first->name_off;
+            ctx->symbols.strings_size = last->name_off + last->name_len - first->name_off;
+        }
+
+        for (size_t i = 0; i < block->record_count; i++) {
+            const struct cache_record *record = &records[block->record_start + i];
+            struct symbol_entry *entry = &ctx->symbols.entries[ctx->symbols.count++];
+
+            entry->st_value = record->value;
+            entry->st_size = record->size;
+            entry->st_name = strings + record->name_off;
+            entry->st_name_len = record->name_len;
+            entry->st_shndx = record->shndx;
+            entry->type = record->type;
+        }
+
+        print_symbols(ctx, &ctx->symbols);
+    }
+}
+
+// Looks the file up in the cache and, on a hit, prints `label` (if any) and
+// the stored tables. On a miss `key` is left filled in for cache_store().
+bool cache_replay(struct nm_context *ctx, int fd, const struct stat *st, const char *label, struct cache_key *key) {
+    struct nm_cache *cache = ctx->cache;
+
+    if (cache_make_key(key, fd, st, ctx->flags)) {
+        return false;
+    }
+
+    char *path = cache_path(cache, key, CACHE_SUFFIX);
+    int cache_fd = path ? open(path, O_RDONLY) : -1;
+    struct stat cache_st;
+    bool hit = false;
+
+    ft_free(path);
+
+    if (cache_fd >= 0 && !fstat(cache_fd, &cache_st) && cache_st.st_size > 0) {
+        unsigned char *mem = mmap(NULL, cache_st.st_size, PROT_READ, MAP_PRIVATE, cache_fd, 0);
+
+        if (mem != MAP_FAILED) {
+            if ((hit = cache_valid(mem, cache_st.st_size, key))) {
+                if (label) {
+                    emit_label(ctx, LABEL_FILE, label, ft_strlen(label));
+                }
+
+                cache_emit(ctx, mem);
+                // The modification time doubles as the LRU clock.
+                futimens(cache_fd, NULL);
+            }
+
+            munmap(mem, cache_st.st_size);
+        }
+    }
+
+    if (cache_fd >= 0) {
+        close(cache_fd);
+    }
+
+    cache_count(cache, hit ? &cache->stats.hits : &cache->stats.misses, 1);
+
+    return hit;
+}
+
+void cache_writer_init(struct cache_writer *writer) {
+    output_init(&writer->blocks, -1);
+    output_init(&writer->records, -1);
+    output_init(&writer->strings, -1);
+    writer->block_count = 0;
+    writer->record_count = 0;
+    writer->open_block = false;
+}
+
+void cache_writer_free(struct cache_writer *writer) {
+    output_free(&writer->blocks);
+    output_free(&writer->records);
+    output_free(&writer->strings);
+    cache_writer_init(writer);
+}
+
+void cache_writer_block(struct cache_writer *writer, const char *label, size_t len) {
+    struct cache_block block = {
+        .label_off = writer->strings.len,
+        .label_len = label ? len : 0,
+        .record_start = writer->record_count,
+        .has_label = label != NULL,
+    };
+
+    if (label) {
+        output_append(&writer->strings, label, len);
+    }
+
+    output_append(&writer->blocks, (char *) &block, sizeof(block));
+    writer->block_count++;
+    writer->open_block = true;
+}
+
+void cache_writer_symbols(struct cache_writer *writer, const struct symbol_table *table) {
+    if (!writer->open_block) {
+        cache_writer_block(writer, NULL, 0);
+    }
+
+    struct cache_block *block = (struct cache_block *) writer->blocks.data + writer->block_count - 1;
+
+    for (size_t i = 0; i < table->count; i++) {
+        struct cache_record record;
+
+        // Zeroed first, padding included, so the same listing always makes
+        // the same file.
+        ft_bzero(&record, sizeof(record));
+        record.value = table->entries[i].st_value;
+        record.size = table->entries[i].st_size;
+        record.name_off = writer->strings.len;
+        record.name_len = table->entries[i].st_name_len;
+        record.shndx = table->entries[i].st_shndx;
+        record.type = table->entries[i].type;
+
+        output_append(&writer->strings, table->entries[i].st_name, record.name_len);
+        output_append(&writer->records, (char *) &record, sizeof(record));
+    }
+
+    block->record_count += table->count;
+    writer->record_count += table->count;
+    writer->open_block = false;
+}
+
+// Appends what a forked context captured, rebasing its offsets.
+void cache_writer_merge(struct cache_writer *parent, struct cache_writer *child) {
+    struct cache_block *blocks = (struct cache_block *) child->blocks.data;
+    struct cache_record *records = (struct cache_record *) child->records.data;
+
+    for (size_t i = 0; i < child->block_count; i++) {
+        blocks[i].label_off += parent->strings.len;
+        blocks[i].record_start += parent->record_count;
+    }
+
+    for (size_t i = 0; i < child->record_count; i++) {
+        records[i].name_off += parent->strings.len;
+    }
+
+    output_append(&parent->blocks, child->blocks.data, child->blocks.len);
+    output_append(&parent->records, child->records.data, child->records.len);
+    output_append(&parent->strings, child->strings.data, child->strings.len);
+    parent->block_count += child->block_count;
+    parent->record_count += child->record_count;
+    parent->open_block = false;
+}
+
+static int compare_age(const void *lhs, const void *rhs) {
+    const struct cache_file *a = lhs, *b = rhs;
+
+    if (a->mtime.tv_sec != b->mtime.tv_sec) {
+        return a->mtime.tv_sec < b->mtime.tv_sec ? -1 : 1;
+    }
+
+    return a->mtime.tv_nsec < b->mtime.tv_nsec ? -1 : a->mtime.tv_nsec > b->mtime.tv_nsec;
+}
+
+// Whether `name` is what cache_store() writes to before renaming it,
+// "<hash>.<pid>.<thread>.tmp", left behind by a process that is gone.
+static bool cache_stale_tmp(const char *name, size_t len) {
+    const char *pid = ft_strchr(name, '.');
+
+    if (len <= 4 || ft_strcmp(name + len - 4, ".tmp") || !pid || !ft_isdigit(pid[1])) {
+        return false;
+    }
+
+    pid_t owner = ft_atoi(pid + 1);
+
+    return owner != getpid() && kill(owner, 0) < 0 && errno == ESRCH;
+}
+
+// Drops least recently used entries until the directory fits the limit
+// again, and the temporary files of writers that died before renaming them.
+static void cache_evict(struct nm_cache *cache) {
+    struct cache_file *files = NULL;
+    size_t count = 0, cap = 0, total = 0, evicted = 0;
+    DIR *handle = opendir(cache->dir);
+    struct dirent *ent;
+
+    while (handle && (ent = readdir(handle))) {
+        struct stat st;
+        size_t len = ft_strlen(ent->d_name);
+
+        if (cache_stale_tmp(ent->d_name, len)) {
+            unlinkat(dirfd(handle), ent->d_name, 0);
+            continue;
+        }
+
+        if (len <= 4 || ft_strcmp(ent->d_name + len - 4, CACHE_SUFFIX) || fstatat(dirfd(handle), ent->d_name, &st, 0)) {
+            continue;
+        }
+
+        if (count == cap) {
+            struct cache_file *grown = ft_malloc((cap = cap ? cap * 2 : 256) * sizeof(struct cache_file));
+
+            if (!grown) {
+                break;
+            }
+
+            if (files) {
+                ft_memcpy(grown, files, count * sizeof(struct cache_file));
+                ft_free(files);
+            }
+
+            files = grown;
+        }
+
+        size_t path_len = ft_strlen(cache->dir) + len + 2;
+
+        if (!(files[count].path = ft_malloc(path_len))) {
+            break;
+        }
+
+        snprintf(files[count].path, path_len, "%s/%s", cache->dir, ent->d_name);
+        files[count].size = st.st_size;
+        files[count].mtime = st.st_mtim;
+        total += st.st_size;
+        count++;
+    }
+
+    if (handle) {
+        closedir(handle);
+    }
+
+    qsort(files, count, sizeof(struct cache_file), &compare_age);
+
+    for (size_t i = 0; i < count; i++) {
+        if (total > cache->limit && !unlink(files[i].path)) {
+            total -= files[i].size;
+            evicted++;
+        }
+
+        ft_free(files[i].path);
+    }
+
+    ft_free(files);
+
+    cache->total = total;
+    cache->stats.evictions += evicted;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len) {
+        ssize_t ret = write(fd, data, len);
+
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (ret <= 0) {
+            return 1;
+        }
+
+        data += ret;
+        len -= ret;
+    }
+
+    return 0;
+}
+
+// Writes the captured tables under a temporary name and renames it into
+// place, so concurrent ft_nm processes never observe a partial entry.
+void cache_store(struct nm_context *ctx, const struct cache_key *key, struct cache_writer *writer) {
+    struct nm_cache *cache = ctx->cache;
+    char suffix[64];
+
+    if (!key->size) {
+        return;
+    }
+
+    snprintf(suffix, sizeof(suffix), ".%d.%lx.tmp", getpid(), (unsigned long) pthread_self());
+
+    char *tmp = cache_path(cache, key, suffix), *path = cache_path(cache, key, CACHE_SUFFIX);
+    int fd = tmp ? open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644) : -1;
+
+    if (fd >= 0) {
+        struct cache_header header = {
+            .version = CACHE_VERSION,
+            .key = *key,
+            .block_count = writer->block_count,
+            .record_count = writer->record_count,
+            .strings_size = writer->strings.len,
+        };
+
+        ft_memcpy(header.magic, CACHE_MAGIC, 8);
+
+        bool failed = write_all(fd, (char *) &header, sizeof(header))
+                      || write_all(fd, writer->blocks.data, writer->blocks.len)
+                      || write_all(fd, writer->records.data, writer->records.len)
+                      || write_all(fd, writer->strings.data, writer->strings.len);
+
+        close(fd);
+
+        if (failed || !path || rename(tmp, path) < 0) {
+            unlink(tmp);
+        } else {
+            size_t size = sizeof(header) + writer->blocks.len + writer->records.len + writer->strings.len;
+
+            pthread_mutex_lock(&cache->lock);
+            cache->stats.stores++;
+            cache->total += size;
+
+            if (cache->limit && cache->total > cache->limit) {
+                cache_evict(cache);
+            }
+
+            pthread_mutex_unlock(&cache->lock);
+        }
+    }
+
+    ft_free(tmp);
+    ft_free(path);
+}
@@ -0,0 +1,70 @@
+#include <libft/string.h>
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "ft_nm.h"
+
+void context_init(struct nm_context *ctx, const struct nm_options *opts, int out_fd, int err_fd) {
+    ctx->opts = opts;
+    ctx->flags = opts->flags;
+    ctx->pool = NULL;
+    ctx->cache = NULL;
+    ctx->demangle = NULL;
+    ctx->top = NULL;
+    ctx->spill = NULL;
+    ctx->capturing = false;
+    ctx->errors = 0;
+    ft_bzero(&ctx->stats, sizeof(ctx->stats));
+    ft_bzero(&ctx->stats_total, sizeof(ctx->stats_total));
+    cache_writer_init(&ctx->capture);
+    symbol_table_init(&ctx->symbols);
+    output_init(&ctx->out, out_fd);
+    output_init(&ctx->err, err_fd);
+}
+
+void context_fork(const struct nm_context *parent, struct nm_context *child) {
+    context_init(child, parent->opts, -1, -1);
+    child->flags = parent->flags;
+    child->cache = parent->cache;
+    child->top = parent->top;
+    child->capturing = parent->capturing;
+}
+
+void context_error(struct nm_context *ctx, const char *format, ...) {
+    char buffer[1024];
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+
+    if ((size_t) len >= sizeof(buffer)) {
+        len = sizeof(buffer) - 1;
+    }
+
+    output_append(&ctx->err, buffer, len);
+    ctx->errors++;
+    context_flush_err(ctx);
+}
+
+// Keeps stdout and stderr interleaved the way a direct write would when the
+// context is attached to real descriptors.
+void context_flush_err(struct nm_context *ctx) {
+    if (ctx->err.fd >= 0) {
+        output_flush(&ctx->out);
+        output_flush(&ctx->err);
+    }
+}
+
+void context_free(struct nm_context *ctx) {
+    output_free(&ctx->out);
+    output_free(&ctx->err);
+    symbol_table_free(&ctx->symbols);
+    demangle_free(ctx->demangle);
+    ctx->demangle = NULL;
+    cache_writer_free(&ctx->capture);
+}
@@ -0,0 +1,227 @@
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <libft/stdio.h>
+#include <libft/string.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+#define DEMANGLE_MIN_SLOTS 1024
+
+typedef char *(*cxa_demangle_t)(const char *mangled, char *buffer, size_t *len, int *status);
+
+struct demangle_entry {
+    char *mangled;
+    size_t mangled_len;
+    const char *name;
+    size_t name_len;
+    unsigned long hash;
+};
+
+// One per thread, like the symbol arena: every distinct mangled name is
+// demangled once and then served from here for the rest of the run.
+struct demangle_cache {
+    struct demangle_entry *slots;
+    size_t mask;
+    size_t count;
+    // Scratch handed to __cxa_demangle, which may realloc() it, so it comes
+    // from the C allocator rather than ft_malloc.
+    char *buffer;
+    size_t buffer_len;
+};
+
+static pthread_once_t demangle_once = PTHREAD_ONCE_INIT;
+static cxa_demangle_t cxa_demangle;
+
+// The demangler is borrowed from the C++ runtime: the one already loaded,
+// if any, else libstdc++. Without it names are printed as they are, which is
+// said once, on the first mangled name.
+static void demangle_load(void) {
+    void *runtime;
+
+    if (!(cxa_demangle = (cxa_demangle_t) dlsym(RTLD_DEFAULT, "__cxa_demangle")) && (runtime = dlopen("libstdc++.so.6", RTLD_LAZY | RTLD_LOCAL))) {
+        cxa_demangle = (cxa_demangle_t) dlsym(runtime, "__cxa_demangle");
+    }
+
+    if (!cxa_demangle) {
+        ft_dprintf(STDERR_FILENO, "ft_nm: -C: C++ runtime not available\n");
+    }
+}
+
+static struct demangle_cache *demangle_create(void) {
+    struct demangle_cache *cache = ft_malloc(sizeof(struct demangle_cache));
+
+    if (!cache) {
+        return NULL;
+    }
+
+    if (!(cache->slots = ft_malloc(DEMANGLE_MIN_SLOTS * sizeof(struct demangle_entry)))) {
+        ft_free(cache);
+        return NULL;
+    }
+
+    ft_bzero(cache->slots, DEMANGLE_MIN_SLOTS * sizeof(struct demangle_entry));
+    cache->mask = DEMANGLE_MIN_SLOTS - 1;
+    cache->count = 0;
+    cache->buffer = NULL;
+    cache->buffer_len = 0;
+
+    return cache;
+}
+
+void demangle_free(struct demangle_cache *cache) {
+    if (!cache) {
+        return;
+    }
+
+    for (size_t i = 0; i <= cache->mask; i++) {
+        ft_free(cache->slots[i].mangled);
+    }
+
+    ft_free(cache->slots);
+    free(cache->buffer);
+    ft_free(cache);
+}
+
+static int demangle_grow(struct demangle_cache *cache) {
+    size_t cap = (cache->mask + 1) * 2;
+    struct demangle_entry *slots = ft_malloc(cap * sizeof(struct demangle_entry));
+
+    if (!slots) {
+        return ERR_NO_MEM;
+    }
+
+    ft_bzero(slots, cap * sizeof(struct demangle_entry));
+
+    for (size_t i = 0; i <= cache->mask; i++) {
+        struct demangle_entry *entry = &cache->slots[i];
+
+        if (!entry->mangled) {
+            continue;
+        }
+
+        size_t slot = entry->hash & (cap - 1);
+
+        while (slots[slot].mangled) {
+            slot = (slot + 1) & (cap - 1);
+        }
+
+        slots[slot] = *entry;
+    }
+
+    ft_free(cache->slots);
+    cache->slots = slots;
+    cache->mask = cap - 1;
+
+    return 0;
+}
+
+// Demangles into a new entry at `slot`. Names the runtime rejects are cached
+// too, as themselves, so they are not retried.
+static struct demangle_entry *demangle_insert(struct demangle_cache *cache, size_t slot, const char *name, size_t len, unsigned long hash) {
+    struct demangle_entry *entry = &cache->slots[slot];
+    int status = -1;
+
+    if (!(entry->mangled = ft_malloc(len + 1))) {
+        return NULL;
+    }
+
+    ft_memcpy(entry->mangled, name, len);
+    entry->mangled[len] = '\0';
+    entry->mangled_len = len;
+    entry->hash = hash;
+    entry->name = entry->mangled;
+    entry->name_len = len;
+
+    char *demangled = cxa_demangle(entry->mangled, cache->buffer, &cache->buffer_len, &status);
+
+    if (demangled) {
+        cache->buffer = demangled;
+    }
+
+    if (!status && demangled) {
+        size_t demangled_len = ft_strlen(demangled);
+        char *text = ft_malloc(len + 1 + demangled_len + 1);
+
+        if (text) {
+            ft_memcpy(text, entry->mangled, len + 1);
+            ft_memcpy(text + len + 1, demangled, demangled_len + 1);
+            ft_free(entry->mangled);
+            entry->mangled = text;
+            entry->name = text + len + 1;
+            entry->name_len = demangled_len;
+        }
+    }
+
+    cache->count++;
+
+    return entry;
+}
+
+// Returns the demangled form of the `len` bytes at `name`, or `name` itself
+// when it is not a mangled C++ name or cannot be demangled.
+const char *demangle_name(struct nm_context *ctx, const char *name, size_t len, size_t *out_len) {
+    *out_len = len;
+
+    if (len < 3 || name[0] != '_' || name[1] != 'Z') {
+        return name;
+    }
+
+    pthread_once(&demangle_once, &demangle_load);
+
+    if (!cxa_demangle || (!ctx->demangle && !(ctx->demangle = demangle_create()))) {
+        return name;
+    }
+
+    struct demangle_cache *cache = ctx->demangle;
+    unsigned long hash = hash_bytes(name, len);
+    size_t slot = hash & cache->mask;
+
+    for (; cache->slots[slot].mangled; slot = (slot + 1) & cache->mask) {
+        struct demangle_entry *entry = &cache->slots[slot];
+
+        if (entry->hash == hash && entry->mangled_len == len && str_mismatch(entry->mangled, name, len) == len) {
+            *out_len = entry->name_len;
+            return entry->name;
+        }
+    }
+
+    // Kept at most half full so probe runs stay short.
+    if (cache->count * 2 >= cache->mask + 1) {
+        if (demangle_grow(cache)) {
+            return name;
+        }
+
+        for (slot = hash & cache->mask; cache->slots[slot].mangled; slot = (slot + 1) & cache->mask) {
+        }
+    }
+
+    struct demangle_entry *entry = demangle_insert(cache, slot, name, len, hash);
+
+    if (!entry) {
+        return name;
+    }
+
+    *out_len = entry->name_len;
+
+    return entry->name;
+}
+
+// Swaps every name in `table` for its demangled form before sorting. The
+// strings belong to the cache, so the sort runs on them as on any other
+// name, without allocating.
+void demangle_table(struct nm_context *ctx, struct symbol_table *table) {
+    for (size_t i = 0; i < table->count; i++) {
+        struct symbol_entry *entry = &table->entries[i];
+        size_t len;
+        const char *name = demangle_name(ctx, entry->st_name, entry->st_name_len, &len);
+
+        if (name != entry->st_name) {
+            entry->st_name = (char *) name;
+            entry->st_name_len = len;
+            entry->key = symbol_key(name, len);
+        }
+    }
+}
@@ -0,0 +1,283 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+struct diff_input {
+    const char *file;
+    unsigned char *mem;
+    size_t size;
+    int class;
+};
+
+static int diff_open(struct nm_context *ctx, const char *file, struct diff_input *input) {
+    int fd = open(file, O_RDONLY);
+    struct stat st;
+
+    input->file = file;
+    input->mem = MAP_FAILED;
+
+    if (fd < 0) {
+        context_error(ctx, "ft_nm: %s: Unable to open file: %s\n", file, strerror(errno));
+        return 1;
+    }
+
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size) {
+        context_error(ctx, "ft_nm: %s: not a regular file\n", file);
+        close(fd);
+        return 1;
+    }
+
+    input->size = st.st_size;
+    input->mem = mmap(NULL, input->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (input->mem == MAP_FAILED) {
+        context_error(ctx, "ft_nm: %s: Unable to mmap memory: %s\n", file, strerror(errno));
+        return 1;
+    }
+
+    input->class = parse_magic((char *) input->mem, input->size);
+
+    if (input->class != ELF32 && input->class != ELF64 && input->class != ARCH) {
+        context_error(ctx, "ft_nm: %s: file format not recognized\n", file);
+        return 1;
+    }
+
+    return 0;
+}
+
+static void diff_close(struct diff_input *input) {
+    if (input->mem != MAP_FAILED) {
+        munmap(input->mem, input->size);
+    }
+}
+
+// Decodes into `table` through ctx->symbols; a missing member or one without
+// symbols leaves it empty.
+static int diff_load(struct nm_context *ctx, struct symbol_table *table, unsigned char *mem, size_t size) {
+    struct symbol_table saved = ctx->symbols;
+    int err = 0;
+
+    ctx->symbols = *table;
+    ctx->symbols.count = 0;
+
+    if (mem && (err = load_table(ctx, mem, size)) == ERR_NO_SYMS) {
+        ctx->symbols.count = 0;
+        err = 0;
+    }
+
+    *table = ctx->symbols;
+    ctx->symbols = saved;
+
+    return err;
+}
+
+static void diff_value(char *dst, const struct symbol_entry *entry) {
+    if (entry->type == 'w' || entry->type == 'U') {
+        ft_memset(dst, ' ', 16);
+    } else {
+        output_hex64(dst, entry->st_value);
+    }
+
+    dst[16] = '\0';
+}
+
+// "- value T name", "+ value T name" or "~ value T -> value T name".
+static void diff_report(struct nm_context *ctx, char mark, const struct symbol_entry *old, const struct symbol_entry *new) {
+    const struct symbol_entry *entry = new ? new : old;
+    size_t name_len = entry->st_name_len;
+    const char *name = entry->st_name;
+    char old_value[17], new_value[17];
+
+    if (ctx->flags & FLAG_DEMANGLE) {
+        name = demangle_name(ctx, name, name_len, &name_len);
+    }
+
+    if (old && new) {
+        diff_value(old_value, old);
+        diff_value(new_value, new);
+        output_printf(&ctx->out, "%c %s %c -> %s %c %.*s\n", mark, old_value, old->type, new_value, new->type, (int) name_len, name);
+    } else {
+        diff_value(new_value, entry);
+        output_printf(&ctx->out, "%c %s %c %.*s\n", mark, new_value, entry->type, (int) name_len, name);
+    }
+}
+
+// Both tables are in name order, so one pass pairs them up; repeated names
+// pair in symbol table order. The label goes out before the first change.
+size_t diff_symbols(struct nm_context *ctx, const struct symbol_table *old, const struct symbol_table *new, const char *label, size_t label_len) {
+    size_t i = 0, j = 0, changes = 0;
+
+    while (true) {
+        while (i < old->count && !symbol_selected(ctx, &old->entries[i])) {
+            i++;
+        }
+
+        while (j < new->count && !symbol_selected(ctx, &new->entries[j])) {
+            j++;
+        }
+
+        if (i == old->count && j == new->count) {
+            break;
+        }
+
+        const struct symbol_entry *lhs = i < old->count ? &old->entries[i] : NULL, *rhs = j < new->count ? &new->entries[j] : NULL;
+        int cmp = !lhs ? 1 : !rhs ? -1 : str_compare(lhs->st_name, lhs->st_name_len, rhs->st_name, rhs->st_name_len);
+
+        if (!cmp && lhs->type == rhs->type && lhs->st_value == rhs->st_value) {
+            i++;
+            j++;
+            continue;
+        }
+
+        if (!changes++ && label) {
+            output_printf(&ctx->out, "\n%.*s:\n", (int) label_len, label);
+        }
+
+        if (cmp < 0) {
+            diff_report(ctx, '-', lhs, NULL);
+            i++;
+        } else if (cmp > 0) {
+            diff_report(ctx, '+', NULL, rhs);
+            j++;
+        } else {
+            diff_report(ctx, '~', lhs, rhs);
+            i++;
+            j++;
+        }
+    }
+
+    return changes;
+}
+
+// Only the two tables of the pair being compared are ever held.
+struct diff_tables {
+    struct symbol_table old;
+    struct symbol_table new;
+    size_t changes;
+};
+
+static int diff_pair(struct nm_context *ctx, struct diff_tables *tables, const struct archive_member *lhs, const struct archive_member *rhs) {
+    const struct archive_member *named = lhs ? lhs : rhs;
+    int err = diff_load(ctx, &tables->old, lhs ? lhs->data : NULL, lhs ? lhs->size : 0);
+
+    if (!err) {
+        err = diff_load(ctx, &tables->new, rhs ? rhs->data : NULL, rhs ? rhs->size : 0);
+    }
+
+    if (!err) {
+        tables->changes += diff_symbols(ctx, &tables->old, &tables->new, named->name, named->name_len);
+    }
+
+    return err;
+}
+
+static bool diff_member(const struct archive_member *member) {
+    return member->class == ELF32 || member->class == ELF64;
+}
+
+// Members are matched by name, the n-th "foo.o" of one archive with the n-th
+// of the other. They usually come in the same order, so the search starts
+// right after the previous match.
+static int diff_archives(struct nm_context *ctx, struct diff_tables *tables, struct diff_input *lhs, struct diff_input *rhs) {
+    struct archive_index old_index, new_index;
+    int old_err = archive_index_build(&old_index, lhs->mem, lhs->size), new_err = archive_index_build(&new_index, rhs->mem, rhs->size), err = 0;
+    bool *matched = NULL;
+
+    if (old_err == ERR_NO_MEM || new_err == ERR_NO_MEM) {
+        err = ERR_NO_MEM;
+        goto err_out;
+    }
+
+    if (!(matched = ft_malloc(new_index.count + 1))) {
+        err = ERR_NO_MEM;
+        goto err_out;
+    }
+
+    ft_bzero(matched, new_index.count + 1);
+
+    for (size_t i = 0, hint = 0; !err && i < old_index.count; i++) {
+        struct archive_member *member = &old_index.members[i], *other = NULL;
+
+        if (!diff_member(member)) {
+            continue;
+        }
+
+        for (size_t n = 0; n < new_index.count; n++) {
+            size_t j = (hint + n) % new_index.count;
+            struct archive_member *candidate = &new_index.members[j];
+
+            if (!matched[j] && diff_member(candidate) && candidate->name_len == member->name_len && !ft_memcmp(candidate->name, member->name, member->name_len)) {
+                other = candidate;
+                matched[j] = true;
+                hint = j + 1;
+                break;
+            }
+        }
+
+        err = diff_pair(ctx, tables, member, other);
+    }
+
+    for (size_t j = 0; !err && j < new_index.count; j++) {
+        if (!matched[j] && diff_member(&new_index.members[j])) {
+            err = diff_pair(ctx, tables, NULL, &new_index.members[j]);
+        }
+    }
+
+    if (old_index.truncated || new_index.truncated) {
+        context_error(ctx, "ft_nm: %s: file truncated\n", old_index.truncated ? lhs->file : rhs->file);
+        err = err ? err : 1;
+    }
+
+err_out:
+    ft_free(matched);
+    archive_index_free(&old_index);
+    archive_index_free(&new_index);
+
+    return err;
+}
+
+// --diff OLD NEW: lists the symbols added, removed or changed in type or
+// value between two builds, member by member for archives. Like diff(1), the
+// result is 0 when nothing changed, 1 when something did and 2 on trouble.
+int diff_files(struct nm_context *ctx, const char *old_file, const char *new_file) {
+    struct diff_input lhs, rhs;
+    struct diff_tables tables = {.changes = 0};
+    int err = 0, flags = ctx->flags;
+
+    // The merge needs both tables in name order whatever -p and -r say.
+    ctx->flags &= ~(FLAG_NO_SORT | FLAG_REV_SORT | FLAG_NUMERIC_SORT | FLAG_SIZE_SORT);
+    symbol_table_init(&tables.old);
+    symbol_table_init(&tables.new);
+
+    if (diff_open(ctx, old_file, &lhs) | diff_open(ctx, new_file, &rhs)) {
+        err = 1;
+    } else if ((lhs.class == ARCH) != (rhs.class == ARCH)) {
+        context_error(ctx, "ft_nm: cannot diff an archive against an object file\n");
+        err = 1;
+    } else if (lhs.class == ARCH) {
+        err = diff_archives(ctx, &tables, &lhs, &rhs);
+    } else {
+        struct archive_member lhs_member = {.data = lhs.mem, .size = lhs.size}, rhs_member = {.data = rhs.mem, .size = rhs.size};
+
+        err = diff_pair(ctx, &tables, &lhs_member, &rhs_member);
+    }
+
+    if (err == ERR_NO_MEM) {
+        context_error(ctx, "ft_nm: not enough memory\n");
+    }
+
+    diff_close(&lhs);
+    diff_close(&rhs);
+    symbol_table_free(&tables.old);
+    symbol_table_free(&tables.new);
+    ctx->flags = flags;
+
+    return err ? 2 : tables.changes > 0;
+}
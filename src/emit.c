@@ -0,0 +1,226 @@
+#include <libft/ctype.h>
+#include <libft/string.h>
+
+#include "ft_nm.h"
+
+// Listings go through one of these, picked by --format. Filtering, the
+// cache capture and the stats stay in print_symbols(), so a backend only
+// decides how the selected symbols look.
+struct emitter {
+    void (*label)(struct nm_context *ctx, int kind, const char *label, size_t len);
+    size_t (*symbols)(struct nm_context *ctx, const struct symbol_table *table);
+};
+
+// Whether -g and -u keep `entry` in a listing.
+bool symbol_selected(const struct nm_context *ctx, const struct symbol_entry *entry) {
+    bool undefined = entry->type == 'w' || entry->type == 'U';
+
+    if (!undefined && ctx->flags & FLAG_EXTERN_ONLY && !ft_isupper(entry->type)) {
+        return false;
+    }
+
+    return undefined || !(ctx->flags & FLAG_UNDEFINED_ONLY);
+}
+
+static const char *symbol_name(struct nm_context *ctx, const struct symbol_entry *entry, size_t *len) {
+    *len = entry->st_name_len;
+
+    if (ctx->flags & FLAG_DEMANGLE) {
+        return demangle_name(ctx, entry->st_name, entry->st_name_len, len);
+    }
+
+    return entry->st_name;
+}
+
+// "%016lx %c %s\n", or the value column blanked for undefined symbols. -S
+// adds the size of defined symbols that have one; --size-sort alone shows
+// the size in place of the value, as binutils does.
+void print_symbol(struct nm_context *ctx, const struct symbol_entry *entry) {
+    bool undefined = entry->type == 'w' || entry->type == 'U';
+    bool sized = !undefined && entry->st_size && ctx->flags & FLAG_PRINT_SIZE;
+    size_t name_len, column = sized ? 34 : 17;
+    const char *name = symbol_name(ctx, entry, &name_len);
+    char *line = output_claim(&ctx->out, column + 2 + name_len + 1);
+
+    if (!line) {
+        return;
+    }
+
+    if (undefined) {
+        ft_memset(line, ' ', 16);
+    } else if ((ctx->flags & (FLAG_SIZE_SORT | FLAG_PRINT_SIZE)) == FLAG_SIZE_SORT) {
+        output_hex64(line, entry->st_size);
+    } else {
+        output_hex64(line, entry->st_value);
+    }
+
+    line[16] = ' ';
+
+    if (sized) {
+        output_hex64(line + 17, entry->st_size);
+        line[33] = ' ';
+    }
+
+    line[column] = entry->type;
+    line[column + 1] = ' ';
+    ft_memcpy(line + column + 2, name, name_len);
+    line[column + 2 + name_len] = '\n';
+}
+
+static void text_label(struct nm_context *ctx, int kind, const char *label, size_t len) {
+    (void) kind;
+    output_printf(&ctx->out, "\n%.*s:\n", (int) len, label);
+}
+
+static size_t text_symbols(struct nm_context *ctx, const struct symbol_table *table) {
+    size_t printed = 0;
+
+    for (size_t i = 0; i < table->count; i++) {
+        if (symbol_selected(ctx, &table->entries[i])) {
+            print_symbol(ctx, &table->entries[i]);
+            printed++;
+        }
+    }
+
+    return printed;
+}
+
+// {"file":"a.out"} or {"member":"foo.o"}, one line each.
+static void jsonl_label(struct nm_context *ctx, int kind, const char *label, size_t len) {
+    output_append(&ctx->out, kind == LABEL_FILE ? "{\"file\":" : "{\"member\":", kind == LABEL_FILE ? 8 : 10);
+    output_json_string(&ctx->out, label, len);
+    output_append(&ctx->out, "}\n", 2);
+}
+
+// {"name":"main","value":4457,"size":35,"type":"T","shndx":14}
+static size_t jsonl_symbols(struct nm_context *ctx, const struct symbol_table *table) {
+    size_t printed = 0;
+
+    for (size_t i = 0; i < table->count; i++) {
+        const struct symbol_entry *entry = &table->entries[i];
+        size_t name_len;
+
+        if (!symbol_selected(ctx, entry)) {
+            continue;
+        }
+
+        const char *name = symbol_name(ctx, entry, &name_len);
+
+        output_append(&ctx->out, "{\"name\":", 8);
+        output_json_string(&ctx->out, name, name_len);
+        output_printf(&ctx->out, ",\"value\":%lu,\"size\":%lu,\"type\":\"%c\",\"shndx\":%u}\n",
+                      entry->st_value, entry->st_size, entry->type, entry->st_shndx);
+        printed++;
+    }
+
+    return printed;
+}
+
+static void bin_label(struct nm_context *ctx, int kind, const char *label, size_t len) {
+    struct nm_bin_frame frame = {.kind = kind, .count = 0, .strings_size = len};
+
+    output_append(&ctx->out, (const char *) &frame, sizeof(frame));
+    output_append(&ctx->out, label, len);
+}
+
+static bool bin_in_strings(const struct symbol_table *table, const char *name, size_t len) {
+    return table->strings && ptr_in_strict(name, len, table->strings, table->strings_size);
+}
+
+// The records point into the table's own string table, which is written out
+// whole and untouched; only names from elsewhere (demangled ones, or those of
+// a file whose string table is unusable) are copied after it.
+static size_t bin_symbols(struct nm_context *ctx, const struct symbol_table *table) {
+    size_t strings_size = table->strings ? table->strings_size : 0, extra = 0, count = 0;
+
+    for (size_t i = 0; i < table->count; i++) {
+        size_t len;
+        const char *name;
+
+        if (!symbol_selected(ctx, &table->entries[i])) {
+            continue;
+        }
+
+        name = symbol_name(ctx, &table->entries[i], &len);
+        extra += bin_in_strings(table, name, len) ? 0 : len;
+        count++;
+    }
+
+    struct nm_bin_frame frame = {.kind = BIN_SYMBOLS, .count = count, .strings_size = strings_size + extra};
+
+    output_append(&ctx->out, (const char *) &frame, sizeof(frame));
+    extra = 0;
+
+    for (size_t i = 0; i < table->count; i++) {
+        const struct symbol_entry *entry = &table->entries[i];
+        size_t len;
+
+        if (!symbol_selected(ctx, entry)) {
+            continue;
+        }
+
+        const char *name = symbol_name(ctx, entry, &len);
+        struct nm_bin_record record = {
+            .value = entry->st_value,
+            .size = entry->st_size,
+            .name_len = len,
+            .shndx = entry->st_shndx,
+            .type = entry->type,
+        };
+
+        if (bin_in_strings(table, name, len)) {
+            record.name_off = name - table->strings;
+        } else {
+            record.name_off = strings_size + extra;
+            extra += len;
+        }
+
+        output_append(&ctx->out, (const char *) &record, sizeof(record));
+    }
+
+    if (strings_size) {
+        output_direct(&ctx->out, table->strings, strings_size);
+    }
+
+    for (size_t i = 0; extra && i < table->count; i++) {
+        size_t len;
+        const char *name;
+
+        if (!symbol_selected(ctx, &table->entries[i])) {
+            continue;
+        }
+
+        name = symbol_name(ctx, &table->entries[i], &len);
+
+        if (!bin_in_strings(table, name, len)) {
+            output_append(&ctx->out, name, len);
+        }
+    }
+
+    return count;
+}
+
+static const struct emitter emitters[] = {
+    [FORMAT_TEXT] = {&text_label, &text_symbols},
+    [FORMAT_JSONL] = {&jsonl_label, &jsonl_symbols},
+    [FORMAT_BIN] = {&bin_label, &bin_symbols},
+};
+
+void emit_label(struct nm_context *ctx, int kind, const char *label, size_t len) {
+    emitters[ctx->opts->format].label(ctx, kind, label, len);
+}
+
+void print_symbols(struct nm_context *ctx, struct symbol_table *table) {
+    unsigned long clock = stats_clock(ctx);
+
+    if (ctx->capturing) {
+        cache_writer_symbols(&ctx->capture, table);
+    }
+
+    size_t printed = emitters[ctx->opts->format].symbols(ctx, table);
+
+    if (ctx->opts->stats) {
+        stats_lap(ctx, PHASE_PRINT, clock);
+        ctx->stats.printed += printed;
+    }
+}
@@ -0,0 +1,183 @@
+#include <elf.h>
+#include <fnmatch.h>
+#include <libft/stdio.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+// The literal text every match has to start with: a glob up to its first
+// wildcard, an anchored regex up to its first operator. A quantifier makes
+// the character before it optional, so that one is given back.
+static size_t pattern_prefix(const char *source, int kind, bool *literal) {
+    const char *metas = kind == PATTERN_GLOB ? "*?[\\" : ".[]()*+?{}|\\^$";
+    const char *start = source, *iter;
+
+    *literal = false;
+
+    if (kind == PATTERN_REGEX) {
+        if (source[0] != '^' || ft_strchr(source, '|')) {
+            return 0;
+        }
+
+        start++;
+    }
+
+    for (iter = start; *iter && !ft_strchr(metas, *iter); iter++);
+
+    if (kind == PATTERN_GLOB && !*iter) {
+        *literal = true;
+    } else if (kind == PATTERN_REGEX && iter > start && (*iter == '*' || *iter == '?' || *iter == '{')) {
+        iter--;
+    }
+
+    return iter - start;
+}
+
+static int pattern_compile(struct nm_pattern *pattern, const char *source, int kind) {
+    pattern->kind = kind;
+    pattern->source = source;
+    pattern->prefix_len = pattern_prefix(source, kind, &pattern->literal);
+    pattern->prefix = kind == PATTERN_REGEX ? source + 1 : source;
+
+    if (kind != PATTERN_REGEX) {
+        return 0;
+    }
+
+    int err = regcomp(&pattern->regex, source, REG_EXTENDED | REG_NOSUB);
+
+    if (err) {
+        char message[256];
+
+        regerror(err, &pattern->regex, message, sizeof(message));
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid regex '%s': %s\n", source, message);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Compiles the --match and --regex patterns once, for every thread to share.
+int filter_compile(struct nm_filter *filter) {
+    size_t count = filter->globs.count + filter->regexes.count;
+
+    filter->active = filter->defined_only || filter->binds || filter->typed || filter->sections.count || count;
+
+    if (!count) {
+        return 0;
+    }
+
+    if (!(filter->patterns = ft_malloc(count * sizeof(struct nm_pattern)))) {
+        return 1;
+    }
+
+    for (size_t i = 0; i < filter->globs.count; i++) {
+        pattern_compile(&filter->patterns[filter->pattern_count++], filter->globs.files[i], PATTERN_GLOB);
+    }
+
+    for (size_t i = 0; i < filter->regexes.count; i++) {
+        if (pattern_compile(&filter->patterns[filter->pattern_count], filter->regexes.files[i], PATTERN_REGEX)) {
+            return 1;
+        }
+
+        filter->pattern_count++;
+    }
+
+    return 0;
+}
+
+void filter_free(struct nm_filter *filter) {
+    for (size_t i = 0; i < filter->pattern_count; i++) {
+        if (filter->patterns[i].kind == PATTERN_REGEX) {
+            regfree(&filter->patterns[i].regex);
+        }
+    }
+
+    ft_free(filter->patterns);
+    filter->patterns = NULL;
+    filter->pattern_count = 0;
+    file_list_free(&filter->sections, filter->sections.count);
+    file_list_free(&filter->globs, filter->globs.count);
+    file_list_free(&filter->regexes, filter->regexes.count);
+}
+
+// Names handed to the filter end with a NUL inside the mapping, as the
+// decoder only keeps those.
+static bool pattern_match(const struct nm_pattern *pattern, const char *name, size_t len) {
+    if (len < pattern->prefix_len || ft_memcmp(name, pattern->prefix, pattern->prefix_len)) {
+        return false;
+    }
+
+    if (pattern->literal) {
+        return len == pattern->prefix_len;
+    }
+
+    if (pattern->kind == PATTERN_GLOB) {
+        return !fnmatch(pattern->source, name, 0);
+    }
+
+    regmatch_t range = {.rm_so = 0, .rm_eo = len};
+
+    return !regexec(&pattern->regex, name, 1, &range, REG_STARTEND);
+}
+
+static int filter_bind(unsigned char bind) {
+    if (bind == STB_LOCAL) {
+        return FILTER_BIND_LOCAL;
+    }
+
+    return bind == STB_WEAK ? FILTER_BIND_WEAK : FILTER_BIND_GLOBAL;
+}
+
+// Whether the decoder should run the filter at all. --lookup and --has
+// answer for every symbol, whatever a listing would show.
+bool filter_enabled(const struct nm_context *ctx) {
+    if (ctx->opts->lookup_count || ctx->opts->has.count) {
+        return false;
+    }
+
+    return ctx->opts->filter.active || ctx->flags & (FLAG_EXTERN_ONLY | FLAG_UNDEFINED_ONLY);
+}
+
+// Cheapest tests first: the type letter and binding, then the section and
+// finally the name patterns, any one of which is enough.
+bool filter_symbol(const struct nm_context *ctx, const struct symbol_entry *entry, unsigned char bind, const char *section) {
+    const struct nm_filter *filter = &ctx->opts->filter;
+
+    if (!symbol_selected(ctx, entry)) {
+        return false;
+    }
+
+    if (!filter->active) {
+        return true;
+    }
+
+    if (filter->defined_only && (entry->type == 'U' || entry->type == 'w' || entry->type == 'v')) {
+        return false;
+    }
+
+    if ((filter->typed && !filter->types[(unsigned char) entry->type]) || (filter->binds && !(filter->binds & filter_bind(bind)))) {
+        return false;
+    }
+
+    if (filter->sections.count) {
+        size_t i = 0;
+
+        while (section && i < filter->sections.count && ft_strcmp(section, filter->sections.files[i])) {
+            i++;
+        }
+
+        if (!section || i == filter->sections.count) {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < filter->pattern_count; i++) {
+        if (pattern_match(&filter->patterns[i], entry->st_name, entry->st_name_len)) {
+            return true;
+        }
+    }
+
+    return !filter->pattern_count;
+}
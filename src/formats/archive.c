@@ -1,13 +1,13 @@
 #include "ft_nm.h"
 #include <ar.h>
 #include <elf.h>
+#include <libft/ctype.h>
 #include <libft/stdlib.h>
 #include <libft/string.h>
 #include <libft/stdio.h>
 #include <stdlib.h>
 
-void filename(char *name, char *funcs, int err) {
-    char *cpy;
+char *archive_member_name(char *name, char *funcs, size_t *len) {
     int i = 0;
 
     while (name[i] != '/') {
@@ -15,32 +15,104 @@ void filename(char *name, char *funcs, int err) {
     }
 
     if (!i && funcs) {
-        filename(funcs + ft_atoi(name + 1), NULL, err);
+        return archive_member_name(funcs + ft_atoi(name + 1), NULL, len);
     } else if (i) {
-        cpy = ft_strndup(name, i);
+        *len = i;
+        return name;
+    }
+
+    return NULL;
+}
+
+// Reads the size field of a member header: decimal digits padded with
+// spaces. Anything else, a sign included, makes the member malformed.
+bool archive_member_size(const struct ar_hdr *hdr, size_t *size) {
+    size_t i = 0;
+
+    *size = 0;
+
+    for (; i < sizeof(hdr->ar_size) && ft_isdigit(hdr->ar_size[i]); i++) {
+        *size = *size * 10 + hdr->ar_size[i] - '0';
+    }
+
+    if (!i) {
+        return false;
+    }
+
+    for (; i < sizeof(hdr->ar_size) && hdr->ar_size[i] == ' '; i++);
+
+    return i == sizeof(hdr->ar_size);
+}
+
+// Returns the GNU long name table ("//"), which sits among the special members
+// at the head of the archive, without walking the regular members.
+char *archive_long_names(unsigned char *ptr, size_t size) {
+    size_t offset = SARMAG;
+
+    while (offset + sizeof(struct ar_hdr) <= size) {
+        struct ar_hdr *hdr = (struct ar_hdr *) (ptr + offset);
+
+        if (!ft_strncmp("//              ", hdr->ar_name, 16)) {
+            return (char *) (hdr + 1);
+        }
+
+        if (hdr->ar_name[0] != '/' || ft_isdigit(hdr->ar_name[1])) {
+            break;
+        }
 
-        if (!err) {
-            ft_printf("\n%s:\n", cpy);
-        } else {
-            ft_dprintf(STDERR_FILENO, "ft_nm: %s: file truncated\n", cpy);
+        size_t member_size;
+
+        if (!archive_member_size(hdr, &member_size)) {
+            break;
+        }
+
+        offset += sizeof(struct ar_hdr) + member_size + (member_size & 1);
+    }
+
+    return NULL;
+}
+
+static int archive_push(struct archive_index *index, struct archive_member *member) {
+    if (index->count == index->cap) {
+        size_t cap = index->cap ? index->cap * 2 : 64;
+        struct archive_member *members = ft_malloc(cap * sizeof(struct archive_member));
+
+        if (!members) {
+            return ERR_NO_MEM;
+        }
+
+        if (index->members) {
+            ft_memcpy(members, index->members, index->count * sizeof(struct archive_member));
+            ft_free(index->members);
         }
 
-        ft_free(cpy);
+        index->members = members;
+        index->cap = cap;
     }
+
+    index->members[index->count++] = *member;
+
+    return 0;
 }
 
-int parse_archive(const char *file, unsigned char *ptr, size_t size, int flags) {
+// First pass over the archive: records where every member lives and what it
+// is called without decoding anything, so members can be parsed out of order.
+int archive_index_build(struct archive_index *index, unsigned char *ptr, size_t size) {
     struct ar_hdr arc;
-    int class;
+    char *func = NULL;
+    unsigned char *start = ptr;
+
+    index->members = NULL;
+    index->count = 0;
+    index->cap = 0;
+    index->truncated = false;
 
     if (!ptr_in_strict(ptr + SARMAG, sizeof(arc), ptr, size)) {
         return 1;
     }
 
-    ft_memcpy(&arc, ptr + SARMAG, sizeof(arc));
     ptr += SARMAG;
     size -= SARMAG;
-    char *func = NULL;
 
     while (size >= sizeof(arc)) {
         if (!ptr_in_strict(ptr, sizeof(arc), ptr, size)) {
@@ -48,30 +120,110 @@ int parse_archive(const char *file, unsigned char *ptr, size_t size, int flags)
         }
 
         ft_memcpy(&arc, ptr, sizeof(arc));
+
+        struct archive_member member = {
+            .header = (struct ar_hdr *) ptr,
+            .offset = ptr - start,
+            .data = ptr + sizeof(arc),
+        };
+        bool sized = archive_member_size(&arc, &member.size);
+
+        member.name = archive_member_name(member.header->ar_name, func, &member.name_len);
         ptr += sizeof(arc);
 
-        if (size < ft_atoi(arc.ar_size) + sizeof(arc)) {
-            filename(arc.ar_name, func, 1);
-            return 1;
+        if (!sized || size < member.size + sizeof(arc)) {
+            index->truncated = true;
+            member.class = ISERR;
+            return archive_push(index, &member);
         }
 
-        size -= ft_atoi(arc.ar_size) + sizeof(arc);
-        class = parse_magic(ptr, ft_atoi(arc.ar_size));
+        size -= member.size + sizeof(arc);
+        member.class = parse_magic((char *) ptr, member.size);
 
-        if (class == ELF32 || class == ELF64) {
-            filename(arc.ar_name, func, 0);
+        if (member.class != ELF32 && member.class != ELF64 && !func && !ft_strncmp("//              ", arc.ar_name, 16)) {
+            func = (char *) ptr;
         }
 
-        if (class == ELF32) {
-            parse_elf_32(ptr, ft_atoi(arc.ar_size), flags);
-        } else if (class == ELF64) {
-            parse_elf_64(ptr, ft_atoi(arc.ar_size), flags);
-        } else if (!func && !ft_strncmp("//              ", arc.ar_name, 16)) {
-            func = ptr;
+        if (archive_push(index, &member)) {
+            return ERR_NO_MEM;
         }
 
-        ptr += ft_atoi(arc.ar_size);
+        ptr += member.size;
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+void archive_index_free(struct archive_index *index) {
+    ft_free(index->members);
+    index->members = NULL;
+    index->count = 0;
+    index->cap = 0;
+}
+
+int archive_parse_member(struct nm_context *ctx, struct archive_member *member) {
+    if (member->class == ISERR) {
+        if (member->name) {
+            context_error(ctx, "ft_nm: %.*s: file truncated\n", (int) member->name_len, member->name);
+        }
+
+        return 0;
+    }
+
+    if (member->class != ELF32 && member->class != ELF64) {
+        return 0;
+    }
+
+    if (ctx->top) {
+        return top_member(ctx, member);
+    }
+
+    if (member->name) {
+        emit_label(ctx, LABEL_MEMBER, member->name, member->name_len);
+    }
+
+    if (ctx->capturing) {
+        cache_writer_block(&ctx->capture, member->name, member->name_len);
+    }
+
+    if (member->class == ELF32) {
+        parse_elf_32(ctx, member->data, member->size);
+    } else {
+        parse_elf_64(ctx, member->data, member->size);
+    }
+
+    return 0;
+}
+
+static int parse_member(struct nm_context *ctx, void *arg, size_t i) {
+    return archive_parse_member(ctx, &((struct archive_index *) arg)->members[i]);
+}
+
+int parse_archive(struct nm_context *ctx, const char *file, unsigned char *ptr, size_t size) {
+    struct archive_index index;
+
+    int err = archive_index_build(&index, ptr, size);
+
+    if (err == ERR_NO_MEM) {
+        archive_index_free(&index);
+        return ERR_NO_MEM;
+    }
+
+    if (ctx->opts->top_merged && (err = top_begin(ctx))) {
+        archive_index_free(&index);
+        return err;
+    }
+
+    // Members are decoded on the pool when one is attached; every member
+    // renders into its own buffer and the pool emits them in archive order.
+    pool_run(ctx->pool, ctx, index.count, &parse_member, &index);
+    top_end(ctx);
+
+    if (index.truncated) {
+        err = 1;
+    }
+
+    archive_index_free(&index);
+
+    return err;
+}
@@ -0,0 +1,126 @@
+#include "ft_nm.h"
+#include <ar.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+
+#define ARMAP_NAME       "/               "
+#define ARMAP_SYM64_NAME "/SYM64/         "
+
+static size_t read_be(const unsigned char *ptr, size_t width) {
+    size_t value = 0;
+
+    for (size_t i = 0; i < width; i++) {
+        value = value << 8 | ptr[i];
+    }
+
+    return value;
+}
+
+static void armap_insert(struct armap *map, const char *name, size_t len, size_t member) {
+    unsigned int hash = hash_bytes(name, len);
+    size_t slot = hash & map->mask;
+
+    while (map->slots[slot].name) {
+        slot = (slot + 1) & map->mask;
+    }
+
+    map->slots[slot] = (struct armap_entry){
+        .name = name,
+        .name_len = len,
+        .hash = hash,
+        .member = member,
+    };
+    map->count++;
+}
+
+// Builds an open-addressed hash index over the archive symbol table, either
+// the SysV "/" member (32-bit big-endian offsets) or "/SYM64/" (64-bit).
+// Only the first member is read; returns ERR_NO_SYMS when it is not an index.
+int armap_load(struct armap *map, unsigned char *mem, size_t size) {
+    map->slots = NULL;
+    map->mask = 0;
+    map->count = 0;
+
+    if (size < SARMAG + sizeof(struct ar_hdr) || ft_strncmp((char *) mem, ARMAG, SARMAG)) {
+        return ERR_NO_SYMS;
+    }
+
+    struct ar_hdr *hdr = (struct ar_hdr *) (mem + SARMAG);
+    unsigned char *body = (unsigned char *) (hdr + 1);
+    size_t body_size = ft_atoi(hdr->ar_size), width;
+
+    if (!ft_strncmp(hdr->ar_name, ARMAP_NAME, 16)) {
+        width = 4;
+    } else if (!ft_strncmp(hdr->ar_name, ARMAP_SYM64_NAME, 16)) {
+        width = 8;
+    } else {
+        return ERR_NO_SYMS;
+    }
+
+    if (!ptr_in_strict(body, body_size, mem, size) || body_size < width) {
+        return ERR_NO_SYMS;
+    }
+
+    size_t count = read_be(body, width);
+
+    if (count > (body_size - width) / width) {
+        return ERR_NO_SYMS;
+    }
+
+    size_t cap = 16;
+
+    while (cap < count * 2) {
+        cap *= 2;
+    }
+
+    if (!(map->slots = ft_malloc(cap * sizeof(struct armap_entry)))) {
+        return ERR_NO_MEM;
+    }
+
+    ft_bzero(map->slots, cap * sizeof(struct armap_entry));
+    map->mask = cap - 1;
+
+    unsigned char *offsets = body + width;
+    char *names = (char *) offsets + count * width, *end = (char *) body + body_size;
+
+    for (size_t i = 0; i < count && names < end; i++) {
+        size_t len = ft_strnlen(names, end - names);
+
+        if (len) {
+            armap_insert(map, names, len, read_be(offsets + i * width, width));
+        }
+
+        names += len + 1;
+    }
+
+    return 0;
+}
+
+// Finds the next entry for `name` after `prev` (NULL for the first one); a
+// symbol defined by several members has one entry per member.
+const struct armap_entry *armap_find(const struct armap *map, const char *name, size_t len, const struct armap_entry *prev) {
+    unsigned int hash = hash_bytes(name, len);
+
+    if (!map->slots) {
+        return NULL;
+    }
+
+    size_t slot = prev ? (size_t) (prev - map->slots + 1) & map->mask : hash & map->mask;
+
+    for (; map->slots[slot].name; slot = (slot + 1) & map->mask) {
+        const struct armap_entry *entry = &map->slots[slot];
+
+        if (entry->hash == hash && entry->name_len == len && !ft_memcmp(entry->name, name, len)) {
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+void armap_free(struct armap *map) {
+    ft_free(map->slots);
+    map->slots = NULL;
+    map->mask = 0;
+    map->count = 0;
+}
@@ -0,0 +1,109 @@
+#include <elf.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+
+#ifdef DEBUG
+#include <libft/stdio.h>
+#endif
+
+#include "ft_nm.h"
+
+#define ELF_BITS   32
+#define ELF_MSB    0
+#define ELF_SUFFIX _32_lsb
+#include "elf_engine.h"
+#undef ELF_BITS
+#undef ELF_MSB
+#undef ELF_SUFFIX
+
+#define ELF_BITS   32
+#define ELF_MSB    1
+#define ELF_SUFFIX _32_msb
+#include "elf_engine.h"
+#undef ELF_BITS
+#undef ELF_MSB
+#undef ELF_SUFFIX
+
+#define ELF_BITS   64
+#define ELF_MSB    0
+#define ELF_SUFFIX _64_lsb
+#include "elf_engine.h"
+#undef ELF_BITS
+#undef ELF_MSB
+#undef ELF_SUFFIX
+
+#define ELF_BITS   64
+#define ELF_MSB    1
+#define ELF_SUFFIX _64_msb
+#include "elf_engine.h"
+#undef ELF_BITS
+#undef ELF_MSB
+#undef ELF_SUFFIX
+
+int parse_elf_32(struct nm_context *ctx, unsigned char *mem, size_t size) {
+    if (size > EI_DATA && mem[EI_DATA] == ELFDATA2MSB) {
+        return parse_elf_32_msb(ctx, mem, size);
+    }
+
+    return parse_elf_32_lsb(ctx, mem, size);
+}
+
+int parse_elf_64(struct nm_context *ctx, unsigned char *mem, size_t size) {
+    if (size > EI_DATA && mem[EI_DATA] == ELFDATA2MSB) {
+        return parse_elf_64_msb(ctx, mem, size);
+    }
+
+    return parse_elf_64_lsb(ctx, mem, size);
+}
+
+int has_dynamic(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size) {
+    bool msb = size > EI_DATA && mem[EI_DATA] == ELFDATA2MSB;
+    int class = parse_magic((char *) mem, size);
+
+    if (class == ELF32) {
+        return msb ? has_dynamic_32_msb(ctx, file, mem, size) : has_dynamic_32_lsb(ctx, file, mem, size);
+    } else if (class == ELF64) {
+        return msb ? has_dynamic_64_msb(ctx, file, mem, size) : has_dynamic_64_lsb(ctx, file, mem, size);
+    }
+
+    return ERR_NO_SYMS;
+}
+
+int load_elf(struct nm_context *ctx, unsigned char *mem, size_t size) {
+    bool msb = size > EI_DATA && mem[EI_DATA] == ELFDATA2MSB;
+    int class = parse_magic((char *) mem, size);
+
+    if (class == ELF32) {
+        return msb ? load_elf_32_msb(ctx, mem, size) : load_elf_32_lsb(ctx, mem, size);
+    } else if (class == ELF64) {
+        return msb ? load_elf_64_msb(ctx, mem, size) : load_elf_64_lsb(ctx, mem, size);
+    }
+
+    return ERR_NO_SYMS;
+}
+
+int load_table(struct nm_context *ctx, unsigned char *mem, size_t size) {
+    bool msb = size > EI_DATA && mem[EI_DATA] == ELFDATA2MSB;
+    int class = parse_magic((char *) mem, size);
+
+    if (class == ELF32) {
+        return msb ? load_table_32_msb(ctx, mem, size) : load_table_32_lsb(ctx, mem, size);
+    } else if (class == ELF64) {
+        return msb ? load_table_64_msb(ctx, mem, size) : load_table_64_lsb(ctx, mem, size);
+    }
+
+    return ERR_NO_SYMS;
+}
+
+int stream_elf_ranges(struct nm_stream *stream) {
+    bool msb = stream->size > EI_DATA && stream->mem[EI_DATA] == ELFDATA2MSB;
+    int class = parse_magic((char *) stream->mem, stream->size);
+
+    if (class == ELF32) {
+        return msb ? stream_ranges_32_msb(stream) : stream_ranges_32_lsb(stream);
+    } else if (class == ELF64) {
+        return msb ? stream_ranges_64_msb(stream) : stream_ranges_64_lsb(stream);
+    }
+
+    return ERR_NO_SYMS;
+}
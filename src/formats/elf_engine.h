@@ -0,0 +1,809 @@
+// Generic ELF symbol decoder. elf.c includes this file once per supported
+// class and byte order after defining:
+//
+//   ELF_BITS    32 or 64
+//   ELF_MSB     1 when the file is big-endian
+//   ELF_SUFFIX  suffix appended to every generated name (_64_lsb, ...)
+//
+// so every field read below is a plain load or a fixed byte swap, resolved
+// at compile time instead of branching on the file's byte order.
+
+#define ELF_CAT_(a, b) a##b
+#define ELF_CAT(a, b)  ELF_CAT_(a, b)
+#define ELF_NAME(name) ELF_CAT(name, ELF_SUFFIX)
+
+#if ELF_BITS == 64
+#define Elf_(type)     Elf64_##type
+#define ELF_ST_TYPE_   ELF64_ST_TYPE
+#define ELF_ST_BIND_   ELF64_ST_BIND
+#else
+#define Elf_(type)     Elf32_##type
+#define ELF_ST_TYPE_   ELF32_ST_TYPE
+#define ELF_ST_BIND_   ELF32_ST_BIND
+#endif
+
+#if ELF_MSB == (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define E16(x) (x)
+#define E32(x) (x)
+#define E64(x) (x)
+#else
+#define E16(x) __builtin_bswap16(x)
+#define E32(x) __builtin_bswap32(x)
+#define E64(x) __builtin_bswap64(x)
+#endif
+
+// Addresses, offsets and sizes follow the class; names, types and section
+// indices have the same width in both.
+#if ELF_BITS == 64
+#define EW(x) E64(x)
+#else
+#define EW(x) E32(x)
+#endif
+
+struct ELF_NAME(elf_file) {
+    unsigned char *mem;
+    size_t size;
+    Elf_(Shdr) *shdr;
+    char *str;
+    char *shstr;
+    size_t shnum;
+    Elf_(Phdr) *phdr;
+    size_t phnum;
+    unsigned char *sections;
+    size_t section_count;
+};
+
+static char ELF_NAME(decode_section_type)(struct ELF_NAME(elf_file) *elf, Elf_(Sym) *sym, Elf_(Shdr) *symbol_header) {
+#ifdef DEBUG
+    char *name = elf->str + E32(sym->st_name);
+    ft_printf("flags %s type %d flags: %lX\n", name, E32(symbol_header->sh_type), (unsigned long) EW(symbol_header->sh_flags));
+#else
+    (void) elf;
+#endif
+
+    if (ELF_ST_TYPE_(sym->st_info) == STT_FUNC) {
+        return 't';
+    }
+
+    return section_flags_type(E32(symbol_header->sh_type), EW(symbol_header->sh_flags), EW(symbol_header->sh_offset));
+}
+
+// Stands in for decode_section_type() when the section headers are gone:
+// the PT_LOAD segment holding the value tells code, data and bss apart.
+static char ELF_NAME(segment_type)(struct ELF_NAME(elf_file) *elf, Elf_(Sym) *sym) {
+    unsigned long value = EW(sym->st_value);
+
+    for (size_t i = 0; i < elf->phnum; i++) {
+        Elf_(Phdr) *phdr = &elf->phdr[i];
+        unsigned long vaddr = EW(phdr->p_vaddr);
+        unsigned int flags = E32(phdr->p_flags);
+
+        if (E32(phdr->p_type) != PT_LOAD || value < vaddr || value - vaddr >= EW(phdr->p_memsz)) {
+            continue;
+        }
+
+        if (ELF_ST_TYPE_(sym->st_info) == STT_FUNC || flags & PF_X) {
+            return 't';
+        } else if (value - vaddr >= EW(phdr->p_filesz)) {
+            return 'b';
+        } else {
+            return flags & PF_W ? 'd' : 'r';
+        }
+    }
+
+    return '?';
+}
+
+static char ELF_NAME(symbol_get_type)(struct ELF_NAME(elf_file) *elf, Elf_(Sym) *sym) {
+    unsigned int shndx = E16(sym->st_shndx);
+    char c = 0;
+
+    if (shndx == SHN_COMMON) {
+        return 'C';
+    }
+
+    if (shndx == SHN_UNDEF) {
+        if (ELF_ST_BIND_(sym->st_info) == STB_WEAK) {
+            if (ELF_ST_TYPE_(sym->st_info) == STT_OBJECT) {
+                return 'v';
+            } else {
+                return 'w';
+            }
+        } else {
+            return 'U';
+        }
+    }
+
+    if (shndx < elf->section_count) {
+        return symbol_class_type(elf->sections, sym->st_info, shndx);
+    }
+
+    if (ELF_ST_TYPE_(sym->st_info) == STT_GNU_IFUNC) {
+        return 'i';
+    }
+
+    if (ELF_ST_BIND_(sym->st_info) == STB_WEAK) {
+        if (ELF_ST_TYPE_(sym->st_info) == STT_OBJECT) {
+            return 'V';
+        } else {
+            return 'W';
+        }
+    }
+
+    if (ELF_ST_BIND_(sym->st_info) != STB_GLOBAL && ELF_ST_BIND_(sym->st_info) != STB_LOCAL) {
+        return 'u';
+    }
+
+    if (shndx != SHN_ABS && !elf->shdr) {
+        c = ELF_NAME(segment_type)(elf, sym);
+    } else if (shndx != SHN_ABS) {
+        Elf_(Shdr) *symbol_header = elf->shdr + shndx;
+
+        if (!ptr_in_strict(symbol_header, sizeof(Elf_(Shdr)), elf->mem, elf->size)) {
+            return '?';
+        }
+
+        char *name = elf->str + E32(symbol_header->sh_name);
+
+        if (!ptr_in(name, elf->mem, elf->size)) {
+            return '?';
+        }
+
+        c = section_name_type(name);
+        if (c == '?') {
+            c = ELF_NAME(decode_section_type)(elf, sym, symbol_header);
+        }
+    }
+
+    if (ELF_ST_BIND_(sym->st_info) == STB_GLOBAL) {
+        if (c >= 'a' && c <= 'z') {
+            c = c - 32;
+        }
+    }
+
+    return c;
+}
+
+// Classifies every section once, the way symbol_get_type() would for each of
+// its symbols. Sections whose header or name is out of bounds get '?', as
+// they would there.
+static int ELF_NAME(classify_sections)(struct nm_context *ctx, struct ELF_NAME(elf_file) *elf) {
+    if (!elf->shdr || !elf->shnum) {
+        return 0;
+    }
+
+    if (!(elf->sections = symbol_table_sections(&ctx->symbols, elf->shnum))) {
+        return ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < elf->shnum; i++) {
+        Elf_(Shdr) *shdr = elf->shdr + i;
+        char *name = ptr_in_strict(shdr, sizeof(Elf_(Shdr)), elf->mem, elf->size) ? elf->str + E32(shdr->sh_name) : NULL;
+
+        if (!name || !ptr_in(name, elf->mem, elf->size)) {
+            elf->sections[i] = '?';
+        } else {
+            elf->sections[i] = section_class(name, E32(shdr->sh_type), EW(shdr->sh_flags), EW(shdr->sh_offset));
+        }
+    }
+
+    elf->section_count = elf->shnum;
+
+    return 0;
+}
+
+// The name of the section `sym` is defined in, for --section; NULL when it
+// has none or its header is out of bounds.
+static const char *ELF_NAME(section_name)(struct ELF_NAME(elf_file) *elf, Elf_(Sym) *sym) {
+    unsigned int shndx = E16(sym->st_shndx);
+
+    if (!elf->shdr || !elf->shstr || shndx == SHN_UNDEF || shndx >= elf->shnum) {
+        return NULL;
+    }
+
+    Elf_(Shdr) *shdr = elf->shdr + shndx;
+
+    if (!ptr_in_strict(shdr, sizeof(Elf_(Shdr)), elf->mem, elf->size)) {
+        return NULL;
+    }
+
+    char *name = elf->shstr + E32(shdr->sh_name);
+    size_t max = ptr_in(name, elf->mem, elf->size) ? ptr_max_size(name, elf->mem, elf->size) : 0;
+
+    return max && str_nlen(name, max) < max ? name : NULL;
+}
+
+// Decodes `entries` symbols at `sym` into ctx->symbols, unsorted. When the
+// `str_size` bytes of the string table are mapped and end with a NUL, names
+// inside it need no bound of their own. Symbols the filter turns down are
+// dropped here, before they take a slot in the table or reach the sort.
+static int ELF_NAME(decode_symbols)(struct nm_context *ctx, struct ELF_NAME(elf_file) *elf, Elf_(Sym) *sym, size_t entries, char *str, size_t str_size) {
+    unsigned char *mem = elf->mem;
+    size_t size = elf->size, skipped_file = 0, skipped_name = 0, skipped_type = 0, skipped_filter = 0;
+    bool filter = filter_enabled(ctx), sections = ctx->opts->filter.sections.count;
+    unsigned long clock = stats_clock(ctx);
+    int err = 0;
+
+    if (!str_size || !ptr_in_strict(str, str_size, mem, size) || str[str_size - 1]) {
+        str_size = 0;
+    }
+
+    // Entries past the end of the mapping are rejected by the loop below, so
+    // there is no point in reserving room for them.
+    size_t available = ptr_max_size(sym, mem, size) / sizeof(Elf_(Sym)) + 1;
+
+    if (entries > available) {
+        entries = available;
+    }
+
+    // --top keeps a heap of its winners instead of the whole table; past
+    // --memory-limit, the table is cut into runs sorted on disk.
+    size_t top = ctx->opts->top, run = spill_capacity(ctx, entries), spilled = 0;
+    size_t reserved = top && top < entries ? top + 1 : run ? run : entries;
+
+    if (symbol_table_reset(&ctx->symbols, reserved) || ELF_NAME(classify_sections)(ctx, elf)) {
+        return ERR_NO_MEM;
+    }
+
+    ctx->symbols.strings = str;
+    ctx->symbols.strings_size = str_size;
+
+    for (size_t i = 0; i < entries; i++) {
+        if (!ptr_in(sym + i, mem, size)) {
+            err = ERR_NO_SYMS;
+            goto err_out;
+        }
+
+        if (ELF_ST_TYPE_(sym[i].st_info) == STT_FILE) {
+            skipped_file++;
+            continue;
+        }
+
+        size_t offset = E32(sym[i].st_name), len;
+        char *name = str + offset;
+
+        if (!ptr_in(name, mem, size)) {
+            err = ERR_NO_SYMS;
+            goto err_out;
+        }
+
+        if (offset < str_size) {
+            len = str_len(name);
+        } else if ((len = str_nlen(name, ptr_max_size(name, mem, size))) == (size_t) ptr_max_size(name, mem, size)) {
+            len = 0;
+        }
+
+        if (!len) {
+            skipped_name++;
+            continue;
+        }
+
+        char type = ELF_NAME(symbol_get_type)(elf, &sym[i]);
+
+        if (!type) {
+            skipped_type++;
+            continue;
+        }
+
+        struct symbol_entry *entry = &ctx->symbols.entries[ctx->symbols.count];
+        entry->st_name = name;
+        entry->st_name_len = len;
+        entry->key = symbol_key(name, len);
+        entry->type = type;
+        entry->st_size = EW(sym[i].st_size);
+        entry->st_shndx = E16(sym[i].st_shndx);
+
+        if (E16(sym[i].st_shndx) == SHN_COMMON) {
+            entry->st_value = EW(sym[i].st_size);
+        } else {
+            entry->st_value = EW(sym[i].st_value);
+        }
+
+        if (filter && !filter_symbol(ctx, entry, ELF_ST_BIND_(sym[i].st_info), sections ? ELF_NAME(section_name)(elf, &sym[i]) : NULL)) {
+            skipped_filter++;
+            continue;
+        }
+
+        if (top) {
+            top_offer(ctx, &ctx->symbols, top);
+        } else if (++ctx->symbols.count == run) {
+            spilled += run;
+
+            if ((err = spill_run(ctx, &ctx->symbols))) {
+                goto err_out;
+            }
+        }
+    }
+
+err_out:
+    if (ctx->opts->stats) {
+        stats_lap(ctx, PHASE_DECODE, clock);
+        ctx->stats.allocated += reserved;
+        ctx->stats.symbols_seen += spilled + ctx->symbols.count + skipped_file + skipped_name + skipped_type + skipped_filter;
+        ctx->stats.skipped_file += skipped_file;
+        ctx->stats.skipped_name += skipped_name;
+        ctx->stats.skipped_type += skipped_type;
+        ctx->stats.skipped_filter += skipped_filter;
+    }
+
+    return err;
+}
+
+// Decodes the symbol table into ctx->symbols, unsorted.
+static int ELF_NAME(load_elf)(struct nm_context *ctx, unsigned char *mem, size_t size) {
+    struct ELF_NAME(elf_file) elf = {.mem = mem, .size = size};
+    Elf_(Shdr) *symtab = NULL, *strtab = NULL, *shdr;
+    Elf_(Ehdr) *elf_header;
+    char *str;
+    int err = 0;
+    unsigned long clock = stats_clock(ctx);
+
+    if (size < sizeof(Elf_(Ehdr))) {
+        err = ERR_NO_SYMS;
+        goto err_out;
+    }
+
+    elf_header = (Elf_(Ehdr) *) mem;
+    shdr = (Elf_(Shdr) *) (mem + EW(elf_header->e_shoff));
+
+    if (!ptr_in_strict(shdr + E16(elf_header->e_shstrndx), sizeof(Elf_(Shdr)), mem, size)) {
+        err = ERR_NO_SYMS;
+        goto err_out;
+    }
+
+    str = (char *) (mem + EW(shdr[E16(elf_header->e_shstrndx)].sh_offset));
+
+    if (!ptr_in(str, mem, size)) {
+        err = ERR_NO_SYMS;
+        goto err_out;
+    }
+
+    for (size_t i = 0, shnum = E16(elf_header->e_shnum); i < shnum; i++) {
+        if (!ptr_in_strict(shdr + i, sizeof(Elf_(Shdr)), mem, size)) {
+            err = ERR_NO_SYMS;
+            goto err_out;
+        }
+
+        char *name = str + E32(shdr[i].sh_name);
+
+        if (!shdr[i].sh_size || !ptr_in_strict(name, 8, mem, size)) {
+            continue;
+        }
+
+        if (!ft_strncmp(name, ".symtab", sizeof(".symtab"))) {
+            symtab = &shdr[i];
+        }
+
+        if (!ft_strncmp(name, ".strtab", sizeof(".strtab"))) {
+            strtab = &shdr[i];
+        }
+    }
+
+    if (!ptr_in(symtab, mem, size) || !ptr_in(strtab, mem, size)) {
+        err = ERR_NO_SYMS;
+        goto err_out;
+    }
+
+    Elf_(Sym) *sym = (Elf_(Sym) *) (mem + EW(symtab->sh_offset));
+    elf.shstr = str;
+    str = (char *) (mem + EW(strtab->sh_offset));
+    elf.shdr = shdr;
+    elf.shnum = E16(elf_header->e_shnum);
+    elf.str = str;
+
+    if (!ptr_in(sym, mem, size) || !ptr_in(str, mem, size)) {
+        err = ERR_NO_SYMS;
+        goto err_out;
+    }
+
+    if (!symtab->sh_entsize) {
+        err = ERR_NO_SYMS;
+        goto err_out;
+    }
+
+    stats_lap(ctx, PHASE_SCAN, clock);
+
+    return ELF_NAME(decode_symbols)(ctx, &elf, sym, EW(symtab->sh_size) / EW(symtab->sh_entsize), str, EW(strtab->sh_size));
+
+err_out:
+    stats_lap(ctx, PHASE_SCAN, clock);
+
+    return err;
+}
+
+// Reads into `stream` only what load_elf() looks at: the file header, the
+// section headers, the section name table, .symtab and .strtab.
+static int ELF_NAME(stream_ranges)(struct nm_stream *stream) {
+    Elf_(Ehdr) *elf_header = (Elf_(Ehdr) *) stream->mem;
+
+    if (stream->size < sizeof(Elf_(Ehdr)) || stream_fetch(stream, 0, sizeof(Elf_(Ehdr)))) {
+        return ERR_NO_SYMS;
+    }
+
+    size_t shoff = EW(elf_header->e_shoff), shnum = E16(elf_header->e_shnum), shstrndx = E16(elf_header->e_shstrndx);
+    Elf_(Shdr) *shdr = (Elf_(Shdr) *) (stream->mem + shoff);
+
+    if (shoff > stream->size || stream_fetch(stream, shoff, shnum * sizeof(Elf_(Shdr)))) {
+        return ERR_NO_SYMS;
+    }
+
+    if (!ptr_in_strict(shdr + shstrndx, sizeof(Elf_(Shdr)), stream->mem, stream->size)) {
+        return ERR_NO_SYMS;
+    }
+
+    size_t stroff = EW(shdr[shstrndx].sh_offset);
+    char *str = (char *) (stream->mem + stroff);
+
+    if (stream_fetch(stream, stroff, EW(shdr[shstrndx].sh_size))) {
+        return ERR_NO_SYMS;
+    }
+
+    for (size_t i = 0; i < shnum && ptr_in_strict(shdr + i, sizeof(Elf_(Shdr)), stream->mem, stream->size); i++) {
+        char *name = str + E32(shdr[i].sh_name);
+
+        if (!ptr_in_strict(name, 8, stream->mem, stream->size)) {
+            continue;
+        }
+
+        if (!ft_strncmp(name, ".symtab", sizeof(".symtab")) || !ft_strncmp(name, ".strtab", sizeof(".strtab"))) {
+            if (stream_fetch(stream, EW(shdr[i].sh_offset), EW(shdr[i].sh_size))) {
+                return ERR_NO_SYMS;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Maps a virtual address to its bytes in the file through the PT_LOAD
+// segments, or NULL when no segment holds it.
+static unsigned char *ELF_NAME(vaddr_ptr)(struct ELF_NAME(elf_file) *elf, unsigned long addr, size_t len) {
+    for (size_t i = 0; i < elf->phnum; i++) {
+        Elf_(Phdr) *phdr = &elf->phdr[i];
+        unsigned long vaddr = EW(phdr->p_vaddr), filesz = EW(phdr->p_filesz);
+
+        if (E32(phdr->p_type) != PT_LOAD || addr < vaddr || addr - vaddr >= filesz) {
+            continue;
+        }
+
+        unsigned char *ptr = elf->mem + EW(phdr->p_offset) + (addr - vaddr);
+
+        return ptr_in_strict(ptr, len, elf->mem, elf->size) ? ptr : NULL;
+    }
+
+    return NULL;
+}
+
+// The symbol count is the highest index any DT_GNU_HASH chain reaches, plus
+// one; the symbols below `symoffset` are not hashed at all.
+static size_t ELF_NAME(gnu_hash_count)(struct ELF_NAME(elf_file) *elf, unsigned int *table) {
+    if (!ptr_in_strict(table, 4 * sizeof(unsigned int), elf->mem, elf->size)) {
+        return 0;
+    }
+
+    size_t nbuckets = E32(table[0]), symoffset = E32(table[1]), bloom_size = E32(table[2]);
+    unsigned int *buckets = (unsigned int *) ((unsigned char *) (table + 4) + bloom_size * sizeof(Elf_(Addr))),
+                 *chain = buckets + nbuckets;
+    size_t last = 0;
+
+    if (bloom_size > elf->size || nbuckets > elf->size || !ptr_in_strict(buckets, nbuckets * sizeof(unsigned int), elf->mem, elf->size)) {
+        return 0;
+    }
+
+    for (size_t i = 0; i < nbuckets; i++) {
+        if (E32(buckets[i]) > last) {
+            last = E32(buckets[i]);
+        }
+    }
+
+    if (last < symoffset) {
+        return symoffset;
+    }
+
+    for (; ptr_in_strict(chain + last - symoffset, sizeof(unsigned int), elf->mem, elf->size); last++) {
+        if (E32(chain[last - symoffset]) & 1) {
+            return last + 1;
+        }
+    }
+
+    return 0;
+}
+
+struct ELF_NAME(dynamic) {
+    Elf_(Sym) *sym;
+    char *str;
+    size_t str_size;
+    unsigned int *gnu_hash;
+    unsigned int *hash;
+};
+
+// Locates the dynamic symbol table and its hash tables through PT_DYNAMIC,
+// so stripped section headers do not matter. Section headers are optional:
+// when present they give the same types nm prints, otherwise the segments
+// stand in for them.
+static int ELF_NAME(find_dynamic)(struct ELF_NAME(elf_file) *elf, struct ELF_NAME(dynamic) *dynamic) {
+    unsigned char *mem = elf->mem;
+    size_t size = elf->size;
+
+    if (size < sizeof(Elf_(Ehdr))) {
+        return ERR_NO_SYMS;
+    }
+
+    Elf_(Ehdr) *elf_header = (Elf_(Ehdr) *) mem;
+    Elf_(Dyn) *dyn = NULL;
+    size_t dyn_count = 0;
+
+    elf->phdr = (Elf_(Phdr) *) (mem + EW(elf_header->e_phoff));
+    elf->phnum = E16(elf_header->e_phnum);
+
+    if (!elf_header->e_phoff || !ptr_in_strict(elf->phdr, elf->phnum * sizeof(Elf_(Phdr)), mem, size)) {
+        return ERR_NO_SYMS;
+    }
+
+    for (size_t i = 0; i < elf->phnum; i++) {
+        if (E32(elf->phdr[i].p_type) == PT_DYNAMIC) {
+            dyn = (Elf_(Dyn) *) (mem + EW(elf->phdr[i].p_offset));
+            dyn_count = EW(elf->phdr[i].p_filesz) / sizeof(Elf_(Dyn));
+        }
+    }
+
+    if (!dyn || !ptr_in_strict(dyn, dyn_count * sizeof(Elf_(Dyn)), mem, size)) {
+        return ERR_NO_SYMS;
+    }
+
+    unsigned long symtab = 0, strtab = 0, strsz = 0, syment = sizeof(Elf_(Sym)), hash = 0, gnu_hash = 0;
+
+    for (size_t i = 0; i < dyn_count && EW(dyn[i].d_tag) != DT_NULL; i++) {
+        unsigned long value = EW(dyn[i].d_un.d_val);
+
+        switch (EW(dyn[i].d_tag)) {
+            case DT_SYMTAB:
+                symtab = value;
+                break;
+            case DT_STRTAB:
+                strtab = value;
+                break;
+            case DT_STRSZ:
+                strsz = value;
+                break;
+            case DT_SYMENT:
+                syment = value;
+                break;
+            case DT_HASH:
+                hash = value;
+                break;
+            case DT_GNU_HASH:
+                gnu_hash = value;
+                break;
+        }
+    }
+
+    dynamic->sym = (Elf_(Sym) *) ELF_NAME(vaddr_ptr)(elf, symtab, sizeof(Elf_(Sym)));
+    dynamic->str = (char *) ELF_NAME(vaddr_ptr)(elf, strtab, 1);
+    dynamic->str_size = strsz;
+    dynamic->gnu_hash = gnu_hash ? (unsigned int *) ELF_NAME(vaddr_ptr)(elf, gnu_hash, 4 * sizeof(unsigned int)) : NULL;
+    dynamic->hash = hash ? (unsigned int *) ELF_NAME(vaddr_ptr)(elf, hash, 2 * sizeof(unsigned int)) : NULL;
+
+    if (!dynamic->sym || !dynamic->str || syment != sizeof(Elf_(Sym))) {
+        return ERR_NO_SYMS;
+    }
+
+    Elf_(Shdr) *shdr = (Elf_(Shdr) *) (mem + EW(elf_header->e_shoff));
+    size_t shnum = E16(elf_header->e_shnum), shstrndx = E16(elf_header->e_shstrndx);
+
+    if (elf_header->e_shoff && shnum && ptr_in_strict(shdr, shnum * sizeof(Elf_(Shdr)), mem, size)
+        && shstrndx < shnum && ptr_in(mem + EW(shdr[shstrndx].sh_offset), mem, size)) {
+        elf->shdr = shdr;
+        elf->shnum = shnum;
+        elf->str = (char *) (mem + EW(shdr[shstrndx].sh_offset));
+        elf->shstr = elf->str;
+    }
+
+    // Without a hash table, the linker's usual layout puts .dynstr right
+    // after .dynsym.
+    return !dynamic->gnu_hash && !dynamic->hash && strtab <= symtab ? ERR_NO_SYMS : 0;
+}
+
+// Decodes the dynamic symbol table; the symbol count comes from the hash
+// tables instead of a scan.
+static int ELF_NAME(load_dynamic)(struct nm_context *ctx, unsigned char *mem, size_t size) {
+    struct ELF_NAME(elf_file) elf = {.mem = mem, .size = size};
+    struct ELF_NAME(dynamic) dynamic;
+    unsigned long clock = stats_clock(ctx);
+    size_t entries = 0;
+    int err = ELF_NAME(find_dynamic)(&elf, &dynamic);
+
+    if (!err && dynamic.gnu_hash) {
+        entries = ELF_NAME(gnu_hash_count)(&elf, dynamic.gnu_hash);
+    } else if (!err && dynamic.hash) {
+        entries = E32(dynamic.hash[1]);
+    } else if (!err) {
+        entries = (dynamic.str - (char *) dynamic.sym) / sizeof(Elf_(Sym));
+    }
+
+    stats_lap(ctx, PHASE_SCAN, clock);
+
+    if (err || !entries) {
+        return ERR_NO_SYMS;
+    }
+
+    return ELF_NAME(decode_symbols)(ctx, &elf, dynamic.sym, entries, dynamic.str, dynamic.str_size);
+}
+
+static bool ELF_NAME(symbol_is)(struct ELF_NAME(elf_file) *elf, Elf_(Sym) *sym, char *str, const char *name, size_t len) {
+    char *sym_name = str + E32(sym->st_name);
+
+    return ptr_in_strict(sym, sizeof(Elf_(Sym)), elf->mem, elf->size) && ptr_in_strict(sym_name, len + 1, elf->mem, elf->size)
+           && str_mismatch(sym_name, name, len) == len && !sym_name[len];
+}
+
+// One bloom filter word answers most misses; hits walk a single chain.
+static Elf_(Sym) *ELF_NAME(gnu_hash_find)(struct ELF_NAME(elf_file) *elf, struct ELF_NAME(dynamic) *dynamic, const char *name, size_t len) {
+    unsigned int *table = dynamic->gnu_hash, hash = 5381;
+    size_t nbuckets = E32(table[0]), symoffset = E32(table[1]), bloom_size = E32(table[2]), shift = E32(table[3]);
+    Elf_(Addr) *bloom = (Elf_(Addr) *) (table + 4);
+    unsigned int *buckets = (unsigned int *) (bloom + bloom_size), *chain = buckets + nbuckets;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = hash * 33 + (unsigned char) name[i];
+    }
+
+    if (!nbuckets || !bloom_size || bloom_size > elf->size || nbuckets > elf->size) {
+        return NULL;
+    }
+
+    Elf_(Addr) *word = &bloom[(hash / ELF_BITS) % bloom_size];
+    Elf_(Addr) mask = (Elf_(Addr)) 1 << (hash % ELF_BITS) | (Elf_(Addr)) 1 << ((hash >> shift) % ELF_BITS);
+
+    if (!ptr_in_strict(word, sizeof(Elf_(Addr)), elf->mem, elf->size) || (EW(*word) & mask) != mask) {
+        return NULL;
+    }
+
+    if (!ptr_in_strict(buckets + hash % nbuckets, sizeof(unsigned int), elf->mem, elf->size)) {
+        return NULL;
+    }
+
+    size_t index = E32(buckets[hash % nbuckets]);
+
+    if (index < symoffset) {
+        return NULL;
+    }
+
+    for (; ptr_in_strict(chain + index - symoffset, sizeof(unsigned int), elf->mem, elf->size); index++) {
+        unsigned int chain_hash = E32(chain[index - symoffset]);
+
+        if ((chain_hash | 1) == (hash | 1) && ELF_NAME(symbol_is)(elf, dynamic->sym + index, dynamic->str, name, len)) {
+            return dynamic->sym + index;
+        }
+
+        if (chain_hash & 1) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static Elf_(Sym) *ELF_NAME(sysv_hash_find)(struct ELF_NAME(elf_file) *elf, struct ELF_NAME(dynamic) *dynamic, const char *name, size_t len) {
+    unsigned int *table = dynamic->hash, hash = 0;
+    size_t nbucket = E32(table[0]), nchain = E32(table[1]);
+    unsigned int *buckets = table + 2, *chain = buckets + nbucket;
+
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash << 4) + (unsigned char) name[i];
+        hash = (hash ^ (hash >> 24 & 0xf0)) & 0x0fffffff;
+    }
+
+    if (!nbucket || nbucket > elf->size || !ptr_in_strict(buckets + hash % nbucket, sizeof(unsigned int), elf->mem, elf->size)) {
+        return NULL;
+    }
+
+    // Bounded by nchain so a corrupt chain cannot loop forever.
+    size_t index = E32(buckets[hash % nbucket]);
+
+    for (size_t steps = 0; index && index < nchain && steps < nchain; steps++) {
+        if (ELF_NAME(symbol_is)(elf, dynamic->sym + index, dynamic->str, name, len)) {
+            return dynamic->sym + index;
+        }
+
+        if (!ptr_in_strict(chain + index, sizeof(unsigned int), elf->mem, elf->size)) {
+            break;
+        }
+
+        index = E32(chain[index]);
+    }
+
+    return NULL;
+}
+
+// Answers --has from the dynamic hash tables without decoding the symbol
+// table. Returns ERR_NO_SYMS when the file has neither table, so the caller
+// can fall back to a full decode.
+static int ELF_NAME(has_dynamic)(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size) {
+    struct ELF_NAME(elf_file) elf = {.mem = mem, .size = size};
+    struct ELF_NAME(dynamic) dynamic;
+    int err = ELF_NAME(find_dynamic)(&elf, &dynamic);
+    size_t missing = 0;
+
+    if (err || (!dynamic.gnu_hash && !dynamic.hash)) {
+        return ERR_NO_SYMS;
+    }
+
+    for (size_t i = 0; i < ctx->opts->has.count; i++) {
+        const char *name = ctx->opts->has.files[i];
+        size_t len = ft_strlen(name);
+        Elf_(Sym) *sym = dynamic.gnu_hash ? ELF_NAME(gnu_hash_find)(&elf, &dynamic, name, len)
+                                          : ELF_NAME(sysv_hash_find)(&elf, &dynamic, name, len);
+        char type = sym && E16(sym->st_shndx) != SHN_UNDEF ? ELF_NAME(symbol_get_type)(&elf, sym) : 0;
+
+        missing += !has_report(ctx, file, NULL, 0, name, type);
+    }
+
+    return missing ? ERR_MISSING : 0;
+}
+
+// Decodes the table the flags ask for into ctx->symbols, in printed order.
+static int ELF_NAME(load_table)(struct nm_context *ctx, unsigned char *mem, size_t size) {
+    int err = ctx->flags & FLAG_DYNAMIC ? ELF_NAME(load_dynamic)(ctx, mem, size) : ELF_NAME(load_elf)(ctx, mem, size);
+
+    if (err) {
+        return err;
+    }
+
+    unsigned long clock = stats_clock(ctx);
+
+    // The winners of --top come out of the decoder as a heap keyed on size or
+    // value, mangled names breaking ties.
+    if (ctx->opts->top) {
+        top_finish(ctx, &ctx->symbols);
+    } else if (spill_pending(ctx)) {
+        if ((err = spill_run(ctx, &ctx->symbols))) {
+            return err;
+        }
+    } else {
+        if (ctx->flags & FLAG_DEMANGLE_SORT) {
+            demangle_table(ctx, &ctx->symbols);
+        }
+
+        if (!(ctx->flags & FLAG_NO_SORT) && symbol_table_sort(&ctx->symbols, ctx->flags)) {
+            return ERR_NO_MEM;
+        }
+    }
+
+    stats_lap(ctx, PHASE_SORT, clock);
+
+    return 0;
+}
+
+static int ELF_NAME(parse_elf)(struct nm_context *ctx, unsigned char *mem, size_t size) {
+    bool spilling = ctx->opts->memory_limit && !ctx->opts->top;
+
+    if (spilling && spill_begin(ctx)) {
+        return ERR_NO_MEM;
+    }
+
+    int err = ELF_NAME(load_table)(ctx, mem, size);
+
+    if (!err && spill_pending(ctx)) {
+        err = spill_merge(ctx);
+    } else if (!err) {
+        print_symbols(ctx, &ctx->symbols);
+    }
+
+    if (spilling) {
+        spill_end(ctx);
+    }
+
+    return err;
+}
+
+#undef ELF_CAT_
+#undef ELF_CAT
+#undef ELF_NAME
+#undef Elf_
+#undef ELF_ST_TYPE_
+#undef ELF_ST_BIND_
+#undef E16
+#undef E32
+#undef E64
+#undef EW
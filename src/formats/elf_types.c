@@ -0,0 +1,116 @@
+#include <elf.h>
+#include <libft/string.h>
+
+#include "ft_nm.h"
+
+struct section_to_type {
+    const char *section;
+    char type;
+};
+
+static const struct section_to_type stt[] = {
+    {".bss", 'b'},
+    {"*DEBUG*", 'N'},
+    {".debug", 'N'},
+    {".drectve", 'i'},
+    {".edata", 'e'},
+    {".fini", 't'},
+    {".idata", 'i'},
+    {".init", 't'},
+    {".pdata", 'p'},
+    {".rdata", 'r'},
+    {".rodata", 'r'},
+    {".sbss", 's'},
+    {".scommon", 'c'},
+    {".sdata", 'g'},
+    {"vars", 'd'},
+    {"zerovars", 'b'},
+    {0, 0}
+};
+
+char section_name_type(const char *s) {
+    for (const struct section_to_type *t = &stt[0]; t->section; t++) {
+        if (!ft_strncmp(s, t->section, ft_strlen(t->section))) {
+            return t->type;
+        }
+    }
+
+    return '?';
+}
+
+// The type any non-function symbol of a section gets from its header alone.
+char section_flags_type(unsigned int sh_type, unsigned long sh_flags, unsigned long sh_offset) {
+    if (sh_flags & SHF_EXECINSTR) {
+        return 't';
+    }
+
+    if (
+        sh_type == SHT_PROGBITS
+        || sh_type == SHT_HASH
+        || sh_type == SHT_NOTE
+        || sh_type == SHT_INIT_ARRAY
+        || sh_type == SHT_FINI_ARRAY
+        || sh_type == SHT_PREINIT_ARRAY
+        || sh_type == SHT_GNU_LIBLIST
+        || sh_type == SHT_GNU_HASH
+        || sh_type == SHT_DYNAMIC
+    ) {
+        if (!(sh_flags & SHF_WRITE)) {
+            return 'r';
+        } else if (sh_flags & SHF_COMPRESSED) {
+            return 'g';
+        } else {
+            return 'd';
+        }
+    }
+
+    if (sh_flags & SHF_ALLOC) {
+        if (sh_flags & SHF_COMPRESSED) {
+            return 's';
+        } else {
+            return 'b';
+        }
+    }
+
+    if (sh_offset && !(sh_flags & SHF_WRITE)) {
+        return 'n';
+    }
+
+    return '?';
+}
+
+// One entry of the per-section table: a name match wins over everything,
+// otherwise the header decides and STT_FUNC symbols still turn into 't'.
+unsigned char section_class(const char *name, unsigned int sh_type, unsigned long sh_flags, unsigned long sh_offset) {
+    char type = section_name_type(name);
+
+    if (type != '?') {
+        return type;
+    }
+
+    return section_flags_type(sh_type, sh_flags, sh_offset) | SECTION_FUNC;
+}
+
+#define INFO_ROW(notype, object, other) \
+    notype, object, other, other, other, other, other, other, other, other, 'i', other, other, other, other, other
+
+// Indexed by st_info: binding and type settle 'i', 'V', 'W' and 'u' on their
+// own; everything else is left to the section, upper cased when global.
+const unsigned char info_types[256] = {
+    INFO_ROW(0, 0, 0),
+    INFO_ROW(INFO_UPPER, INFO_UPPER, INFO_UPPER),
+    INFO_ROW('W', 'V', 'W'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+    INFO_ROW('u', 'u', 'u'),
+};
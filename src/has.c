@@ -0,0 +1,152 @@
+#include <libft/stdlib.h>
+#include <libft/string.h>
+
+#include "ft_nm.h"
+
+static bool defined_type(char type) {
+    return type && type != 'U' && type != 'w' && type != 'v';
+}
+
+// Prints "file: T name" for a defined symbol and "file: - name" otherwise;
+// returns whether it was a hit.
+bool has_report(struct nm_context *ctx, const char *file, const char *member, size_t member_len, const char *name, char type) {
+    bool hit = defined_type(type);
+
+    if (member) {
+        output_printf(&ctx->out, "%s(%.*s): %c %s\n", file, (int) member_len, member, hit ? type : '-', name);
+    } else {
+        output_printf(&ctx->out, "%s: %c %s\n", file, hit ? type : '-', name);
+    }
+
+    return hit;
+}
+
+// Without a dynamic hash table the whole symbol table is decoded once and
+// hashed, so every query after that is a single probe.
+static int has_table(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size) {
+    int err = load_elf(ctx, mem, size);
+
+    if (err) {
+        return err;
+    }
+
+    size_t cap = 16, missing = 0;
+
+    while (cap < ctx->symbols.count * 2) {
+        cap *= 2;
+    }
+
+    struct symbol_entry **slots = ft_malloc(cap * sizeof(struct symbol_entry *));
+
+    if (!slots) {
+        return ERR_NO_MEM;
+    }
+
+    ft_bzero(slots, cap * sizeof(struct symbol_entry *));
+
+    for (size_t i = 0; i < ctx->symbols.count; i++) {
+        struct symbol_entry *entry = &ctx->symbols.entries[i];
+
+        if (!defined_type(entry->type)) {
+            continue;
+        }
+
+        size_t slot = hash_bytes(entry->st_name, entry->st_name_len) & (cap - 1);
+
+        while (slots[slot]) {
+            slot = (slot + 1) & (cap - 1);
+        }
+
+        slots[slot] = entry;
+    }
+
+    for (size_t i = 0; i < ctx->opts->has.count; i++) {
+        const char *name = ctx->opts->has.files[i];
+        size_t len = ft_strlen(name), slot = hash_bytes(name, len) & (cap - 1);
+        char type = 0;
+
+        for (; slots[slot]; slot = (slot + 1) & (cap - 1)) {
+            if (slots[slot]->st_name_len == len && !ft_memcmp(slots[slot]->st_name, name, len)) {
+                type = slots[slot]->type;
+                break;
+            }
+        }
+
+        missing += !has_report(ctx, file, NULL, 0, name, type);
+    }
+
+    ft_free(slots);
+
+    return missing ? ERR_MISSING : 0;
+}
+
+static char member_type(struct nm_context *ctx, const char *name, size_t len) {
+    for (size_t i = 0; i < ctx->symbols.count; i++) {
+        struct symbol_entry *entry = &ctx->symbols.entries[i];
+
+        if (entry->st_name_len == len && !ft_memcmp(entry->st_name, name, len) && defined_type(entry->type)) {
+            return entry->type;
+        }
+    }
+
+    return 0;
+}
+
+// Archives are answered from their symbol index; only the member that
+// defines a symbol is decoded, for its type letter.
+static int has_archive(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size) {
+    struct armap map;
+    int err = armap_load(&map, mem, size);
+    size_t missing = 0;
+
+    if (err == ERR_NO_SYMS) {
+        context_error(ctx, "ft_nm: %s: no archive symbol index\n", file);
+        return 0;
+    } else if (err) {
+        return err;
+    }
+
+    char *long_names = archive_long_names(mem, size);
+
+    for (size_t i = 0; i < ctx->opts->has.count; i++) {
+        const char *name = ctx->opts->has.files[i];
+        size_t len = ft_strlen(name);
+        const struct armap_entry *entry = armap_find(&map, name, len, NULL);
+        struct lookup_member member;
+        char type = 0;
+
+        if (!entry || !lookup_resolve(mem, size, long_names, entry->member, &member)) {
+            missing += !has_report(ctx, file, NULL, 0, name, 0);
+            continue;
+        }
+
+        if (!load_elf(ctx, member.data, member.size)) {
+            type = member_type(ctx, name, len);
+        }
+
+        missing += !has_report(ctx, file, member.name, member.name_len, name, type);
+    }
+
+    armap_free(&map);
+
+    return missing ? ERR_MISSING : 0;
+}
+
+// Answers --has queries, cheapest source first: the dynamic GNU or SysV hash
+// table, then a hash built over the full symbol table.
+int has_symbols(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size) {
+    int class = parse_magic((char *) mem, size);
+
+    if (class == ARCH) {
+        return has_archive(ctx, file, mem, size);
+    }
+
+    if (class != ELF32 && class != ELF64) {
+        context_error(ctx, "ft_nm: %s: file format not recognized\n", file);
+        return 0;
+    }
+
+    int err = has_dynamic(ctx, file, mem, size);
+
+    return err == ERR_NO_SYMS ? has_table(ctx, file, mem, size) : err;
+}
@@ -0,0 +1,104 @@
+#include <ar.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+
+#include "ft_nm.h"
+
+bool lookup_resolve(unsigned char *mem, size_t size, char *long_names, size_t offset, struct lookup_member *member) {
+    struct ar_hdr *hdr = (struct ar_hdr *) (mem + offset);
+
+    if (offset > size || !ptr_in_strict(hdr, sizeof(struct ar_hdr), mem, size)) {
+        return false;
+    }
+
+    member->data = (unsigned char *) (hdr + 1);
+    member->size = ft_atoi(hdr->ar_size);
+
+    if (!ptr_in_strict(member->data, member->size, mem, size)) {
+        return false;
+    }
+
+    if (!(member->name = archive_member_name(hdr->ar_name, long_names, &member->name_len))) {
+        member->name = hdr->ar_name;
+        member->name_len = 0;
+    }
+
+    return true;
+}
+
+// Decodes the one member that defines `name` and prints its matching lines.
+static int lookup_details(struct nm_context *ctx, const char *file, struct lookup_member *member, const char *name, size_t len) {
+    int err = load_elf(ctx, member->data, member->size);
+
+    if (err) {
+        return err;
+    }
+
+    for (size_t i = 0; i < ctx->symbols.count; i++) {
+        struct symbol_entry *entry = &ctx->symbols.entries[i];
+
+        if (entry->st_name_len == len && !ft_memcmp(entry->st_name, name, len)) {
+            output_printf(&ctx->out, "%s(%.*s): ", file, (int) member->name_len, member->name);
+            print_symbol(ctx, entry);
+        }
+    }
+
+    return 0;
+}
+
+// Answers --lookup queries from the archive symbol index alone: members are
+// only located through the index, and only opened for --lookup-details. A
+// name found nowhere, or no index at all, fails the file as --has does.
+int lookup_symbols(struct nm_context *ctx, const char *file, unsigned char *mem, size_t size) {
+    struct armap map;
+    int err = armap_load(&map, mem, size);
+
+    if (err == ERR_NO_SYMS) {
+        context_error(ctx, "ft_nm: %s: no archive symbol index\n", file);
+        return ERR_MISSING;
+    } else if (err) {
+        return err;
+    }
+
+    char *long_names = archive_long_names(mem, size);
+    size_t missing = 0;
+
+    for (size_t i = 0; i < ctx->opts->lookup_count; i++) {
+        const char *name = ctx->opts->lookup[i];
+        size_t len = ft_strlen(name);
+        const struct armap_entry *entry = armap_find(&map, name, len, NULL);
+        bool found = false;
+
+        if (!entry) {
+            context_error(ctx, "ft_nm: %s: %s: not found\n", file, name);
+        }
+
+        for (; entry; entry = armap_find(&map, name, len, entry)) {
+            struct lookup_member member;
+
+            if (!lookup_resolve(mem, size, long_names, entry->member, &member)) {
+                context_error(ctx, "ft_nm: %s: %s: bad archive index entry\n", file, name);
+                continue;
+            }
+
+            found = true;
+
+            if (!ctx->opts->lookup_details) {
+                output_printf(&ctx->out, "%s(%.*s): %s\n", file, (int) member.name_len, member.name, name);
+            } else if ((err = lookup_details(ctx, file, &member, name, len))) {
+                break;
+            }
+        }
+
+        if (err == ERR_NO_MEM) {
+            break;
+        }
+
+        missing += !found;
+        err = 0;
+    }
+
+    armap_free(&map);
+
+    return err ? err : missing ? ERR_MISSING : 0;
+}
@@ -1,20 +1,24 @@
 #include <ar.h>
 #include <elf.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <libft/ctype.h>
 #include <libft/stdbool.h>
 #include <libft/stdio.h>
 #include <libft/stdlib.h>
-#include <libft/stl/list.h>
 #include <libft/string.h>
 #include <stdio.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include "ft_nm.h"
 
-static int flags = 0;
-static char *mem = NULL;
+struct file_batch {
+    char **files;
+    bool is_multiple;
+};
 
 int parse_magic(char *ptr, size_t size) {
     if (size > SARMAG && !ft_strncmp(ptr, ARMAG, SARMAG)) {
@@ -38,136 +42,260 @@ int parse_magic(char *ptr, size_t size) {
     }
 }
 
-void free_symbols(struct list_head *symbol_list) {
-    struct list_head *iter, *q;
-    list_for_each_safe(iter, q, symbol_list) {
-        list_del(iter);
-        ft_free(iter);
+static int parse_path(struct nm_context *ctx, const char *file, bool is_multiple) {
+    unsigned long clock = stats_clock(ctx);
+    bool is_stdin = !ft_strcmp(file, "-");
+    const int fd = is_stdin ? STDIN_FILENO : open(file, O_RDONLY);
+
+    if (fd < 0) {
+        context_error(ctx, "Unable to open file: %s\n", strerror(errno));
+        return 1;
     }
-}
 
-void print_symbols(struct list_head *symbol_list) {
-    struct symbol_entry *iter;
-    list_for_each_entry(iter, symbol_list, list) {
-        if (iter->type == 'w' || iter->type == 'U') {
-            ft_printf("%18c %s\n", iter->type, iter->st_name);
-            continue;
-        }
+    struct stat file_info;
 
-        if (flags & FLAG_EXTERN_ONLY && !ft_isupper(iter->type)) {
-            continue;
-        }
+    if (fstat(fd, &file_info) < 0) {
+        context_error(ctx, "Unable to get buffer data: %s\n", strerror(errno));
+        goto err_close;
+    }
+
+    struct cache_key key;
+    bool cacheable = ctx->cache && !is_stdin && !ctx->opts->lookup_count && !ctx->opts->has.count && !ctx->opts->top && !ctx->opts->filter.active && !ctx->opts->memory_limit && S_ISREG(file_info.st_mode) && file_info.st_size > 0;
 
-        if (flags & FLAG_UNDEFINED_ONLY) {
-            continue;
+    if (cacheable && cache_replay(ctx, fd, &file_info, is_multiple ? file : NULL, &key)) {
+        if (!is_stdin) {
+            close(fd);
         }
 
-        ft_printf("%016lx %c %s\n", iter->st_value, iter->type, iter->st_name);
+        return 0;
     }
-}
 
-static int parse_file(const char *file, bool is_multiple) {
-    const int fd = open(file, O_RDONLY);
+    // Pipes, terminals and sockets are read as they come; regular files are
+    // only read when they cannot be mapped.
+    bool streamed = is_stdin || S_ISFIFO(file_info.st_mode) || S_ISCHR(file_info.st_mode) || S_ISSOCK(file_info.st_mode);
+    struct nm_stream stream = {0};
+    size_t size = file_info.st_size;
+    char *mem = streamed ? MAP_FAILED : mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
 
-    if (fd < 0) {
-        ft_perror("Unable to open file");
+    if (mem == MAP_FAILED && !streamed && !(S_ISREG(file_info.st_mode) && size)) {
+        context_error(ctx, "Unable to mmap memory: %s\n", strerror(errno));
+        goto err_close;
     }
 
-    struct stat file_info;
+    if (mem == MAP_FAILED) {
+        int err = stream_open(ctx, &stream, fd, &file_info);
 
-    if (fstat(fd, &file_info) < 0) {
-        ft_perror("Unable to get buffer data");
+        if (err) {
+            context_error(ctx, "Unable to read file: %s\n", strerror(err == ERR_NO_MEM ? ENOMEM : errno));
+            stream_close(&stream);
+            goto err_close;
+        }
+
+        mem = (char *) stream.mem;
+        size = stream.size;
     }
 
-    if (!(mem = mmap(NULL, file_info.st_size, PROT_READ, MAP_PRIVATE, fd, 0))) {
-        ft_perror("Unable to mmap memory");
+    if (ctx->opts->stats) {
+        stats_lap(ctx, PHASE_MAP, clock);
+        ctx->stats.bytes_mapped += stream.mem ? stream.fetched : size;
     }
 
-    int class = parse_magic(mem, file_info.st_size), parse_result = 0;
+    int class = stream.sequential ? ARCH : parse_magic(mem, size), parse_result = 0;
+    size_t errors = ctx->errors;
 
-    if (is_multiple) {
-        ft_printf("\n%s:\n", file);
+    ctx->capturing = cacheable;
+
+    if (is_multiple && !ctx->opts->lookup_count && !ctx->opts->has.count) {
+        emit_label(ctx, LABEL_FILE, file, ft_strlen(file));
     }
 
-    if (class == ELF32) {
-        parse_result = parse_elf_32(mem, file_info.st_size, flags);
+    if (ctx->opts->lookup_count) {
+        parse_result = lookup_symbols(ctx, file, (unsigned char *) mem, size);
+    } else if (ctx->opts->has.count) {
+        parse_result = has_symbols(ctx, file, (unsigned char *) mem, size);
+    } else if (stream.sequential) {
+        parse_result = stream_archive(ctx, &stream);
+    } else if (class == ELF32) {
+        parse_result = parse_elf_32(ctx, (unsigned char *) mem, size);
     } else if (class == ELF64) {
-        parse_result = parse_elf_64(mem, file_info.st_size, flags);
+        parse_result = parse_elf_64(ctx, (unsigned char *) mem, size);
     } else if (class == ARCH) {
-        parse_result = parse_archive(file, mem, file_info.st_size, flags);
+        parse_result = parse_archive(ctx, file, (unsigned char *) mem, size);
     } else if (class == NOTELF) {
-        ft_dprintf(2, "ft_nm: %s: file format not recognized\n", file);
+        context_error(ctx, "ft_nm: %s: file format not recognized\n", file);
+    }
+
+    // Only complete, error-free listings are worth replaying later.
+    if (cacheable && !parse_result && ctx->errors == errors && (class == ELF32 || class == ELF64 || class == ARCH)) {
+        cache_store(ctx, &key, &ctx->capture);
     }
 
+    ctx->capturing = false;
+    cache_writer_free(&ctx->capture);
+
+    // Machine-readable listings keep these notes out of the record stream.
+    struct nm_output *notes = ctx->opts->format == FORMAT_TEXT ? &ctx->out : &ctx->err;
     int result = 0;
 
     if (parse_result == ERR_NO_SYMS) {
-        ft_printf("ft_nm: %s: no symbols\n", file);
+        output_printf(notes, "ft_nm: %s: no symbols\n", file);
     } else if (parse_result == ERR_NO_MEM) {
         result = 1;
-        ft_printf("ft_nm: not enough memory\n");
+        output_printf(notes, "ft_nm: not enough memory\n");
+    } else if (parse_result == ERR_MISSING || parse_result == ERR_IO) {
+        result = 1;
     }
 
-    munmap(mem, file_info.st_size);
+    if (stream.mem) {
+        stream_close(&stream);
+    } else {
+        munmap(mem, size);
+    }
+
+    if (!is_stdin) {
+        close(fd);
+    }
 
     return result;
+
+err_close:
+    if (!is_stdin) {
+        close(fd);
+    }
+
+    return 1;
+}
+
+static int parse_file(struct nm_context *ctx, const char *file, bool is_multiple) {
+    if (!ctx->opts->stats) {
+        return parse_path(ctx, file, is_multiple);
+    }
+
+    stats_begin(ctx);
+
+    int result = parse_path(ctx, file, is_multiple);
+
+    stats_end(ctx, file);
+
+    return result;
+}
+
+static int parse_batch_file(struct nm_context *ctx, void *arg, size_t index) {
+    struct file_batch *batch = arg;
+
+    return parse_file(ctx, batch->files[index], batch->is_multiple);
+}
+
+int parse_files(struct nm_context *ctx, char **files, size_t count) {
+    struct file_batch batch = {
+        .files = files,
+        .is_multiple = count > 1,
+    };
+
+    return pool_run(ctx->pool, ctx, count, &parse_batch_file, &batch);
 }
 
 int main(int argc, char **argv) {
-    int ch;
-    getopt_args_t args = FT_GETOPT_INITIALIAZER;
-
-    while ((ch = ft_getopt_arg(argc, argv, "argpu", &args)) != EOF) {
-        switch (ch) {
-            case 'r':
-                if (flags & FLAG_NO_SORT) {
-                    ft_printf("ft_nm: conflicting option -p\n");
-                    return 1;
-                }
-
-                flags |= FLAG_REV_SORT;
-                break;
-
-            case 'p':
-                if (flags & FLAG_REV_SORT) {
-                    ft_printf("ft_nm: conflicting option -r\n");
-                    return 1;
-                }
-
-                flags |= FLAG_NO_SORT;
-                break;
-
-            case 'u':
-                flags |= FLAG_UNDEFINED_ONLY;
-                break;
-
-            case 'g':
-                flags |= FLAG_EXTERN_ONLY;
-                break;
-
-            case 'a':
-                flags |= FLAG_DEBUG_SYMBOLS;
-                break;
-
-            default:
-                return 1;
-        }
+    struct nm_options opts;
+
+    strings_init();
+
+    if (options_parse(&opts, &argc, &argv)) {
+        options_free(&opts);
+        return 1;
     }
 
-    argc -= args.optind;
-    argv += args.optind;
+    struct nm_context ctx;
+    unsigned long start;
+    // The server frames every response itself, so its context stays in memory.
+    if (opts.server) {
+        context_init(&ctx, &opts, -1, -1);
+    } else {
+        context_init(&ctx, &opts, STDOUT_FILENO, STDERR_FILENO);
+    }
 
-    bool is_multiple = argc > 1;
+    if (opts.threads > 1) {
+        ctx.pool = pool_create(opts.threads);
+    }
 
-    if (!argc) {
-        return parse_file("a.out", false);
+    if (opts.cache_dir) {
+        ctx.cache = cache_open(opts.cache_dir, opts.cache_size);
     }
 
+    start = stats_clock(&ctx);
+
+    static char *default_file[] = {"a.out"};
+    struct file_list files = {0};
     int result = 0;
 
-    for (int i = 0; i < argc; i++) {
-        result |= parse_file(argv[i], is_multiple);
+    for (int i = 0; i < argc && !result; i++) {
+        result = file_list_push(&files, argv[i]);
+    }
+
+    if (!result && opts.files_from && (result = file_list_read(&files, opts.files_from, opts.null_separated ? '\0' : '\n'))) {
+        context_error(&ctx, "ft_nm: %s: unable to read file list\n", opts.files_from);
     }
 
+    // Unreadable directories are reported and skipped, like find(1) does,
+    // and only show in the exit status.
+    int walked = 0;
+
+    if (!result && opts.recursive.count && (walked = walk_paths(&ctx, &opts.recursive, &files)) == ERR_NO_MEM) {
+        context_error(&ctx, "ft_nm: not enough memory\n");
+        result = 1;
+    }
+
+    if (result) {
+        result = 1;
+    } else if (opts.server) {
+        result = server_run(&ctx);
+    } else if (opts.top && (opts.diff || opts.watch || opts.lookup_count || opts.has.count)) {
+        context_error(&ctx, "ft_nm: --top only applies to listings\n");
+        result = 1;
+    } else if (opts.diff && files.count != 2) {
+        context_error(&ctx, "ft_nm: --diff takes two files, OLD and NEW\n");
+        result = 2;
+    } else if (opts.diff) {
+        result = diff_files(&ctx, files.files[0], files.files[1]);
+    } else if (opts.watch) {
+        bool listed = files.count || opts.files_from || opts.recursive.count;
+
+        result = watch_files(&ctx, listed ? files.files : default_file, listed ? files.count : 1);
+    } else if (files.count || opts.files_from || opts.recursive.count) {
+        result = parse_files(&ctx, files.files, files.count) || walked;
+    } else {
+        result = parse_files(&ctx, default_file, 1);
+    }
+
+    file_list_free(&files, argc);
+    pool_destroy(ctx.pool);
+    output_flush(&ctx.out);
+
+    if (opts.stats) {
+        struct nm_output err;
+        unsigned long wall = stats_clock(&ctx) - start;
+
+        stats_finish(&ctx.stats_total);
+        output_init(&err, STDERR_FILENO);
+        stats_report(&err, opts.stats, NULL, &ctx.stats_total, wall);
+        output_flush(&err);
+        output_free(&err);
+    }
+
+    if (ctx.cache && opts.cache_stats) {
+        struct cache_stats stats = cache_get_stats(ctx.cache);
+        struct nm_output err;
+
+        output_init(&err, STDERR_FILENO);
+        output_printf(&err, "ft_nm: cache: %zu hits, %zu misses, %zu stores, %zu evictions\n",
+                      stats.hits, stats.misses, stats.stores, stats.evictions);
+        output_flush(&err);
+        output_free(&err);
+    }
+
+    cache_close(ctx.cache);
+    context_free(&ctx);
+    options_free(&opts);
+
     return result;
 }
@@ -0,0 +1,589 @@
+#include <libft/ctype.h>
+#include <libft/stdio.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <stdio.h>
+
+#include "ft_nm.h"
+
+enum long_option_arg {
+    LONG_NO_ARG,
+    LONG_REQUIRED_ARG,
+    LONG_OPTIONAL_ARG,
+};
+
+struct long_option {
+    const char *name;
+    enum long_option_arg arg;
+    int (*apply)(struct nm_options *opts, char *value);
+};
+
+static int opt_lookup(struct nm_options *opts, char *value) {
+    opts->lookup[opts->lookup_count++] = value;
+    return 0;
+}
+
+static int opt_lookup_details(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->lookup_details = true;
+    return 0;
+}
+
+// Parses a byte count with an optional K, M or G suffix.
+static int parse_size(const char *value, size_t *size) {
+    size_t result = 0;
+    const char *iter = value;
+
+    for (; ft_isdigit(*iter); iter++) {
+        result = result * 10 + (*iter - '0');
+    }
+
+    if (iter == value) {
+        return 1;
+    }
+
+    switch (*iter) {
+        case 'G':
+        case 'g':
+            result <<= 10;
+            // fallthrough
+        case 'M':
+        case 'm':
+            result <<= 10;
+            // fallthrough
+        case 'K':
+        case 'k':
+            result <<= 10;
+            iter++;
+            break;
+    }
+
+    *size = result;
+
+    return *iter != '\0';
+}
+
+static int opt_cache_dir(struct nm_options *opts, char *value) {
+    opts->cache_dir = value;
+    return 0;
+}
+
+static int opt_cache_size(struct nm_options *opts, char *value) {
+    if (parse_size(value, &opts->cache_size)) {
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid cache size '%s'\n", value);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int opt_memory_limit(struct nm_options *opts, char *value) {
+    if (parse_size(value, &opts->memory_limit) || !opts->memory_limit) {
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid memory limit '%s'\n", value);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int opt_cache_stats(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->cache_stats = true;
+    return 0;
+}
+
+// The style argument binutils takes is accepted and ignored: the C++ runtime
+// only knows its own ABI.
+static int opt_demangle(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->flags |= FLAG_DEMANGLE;
+    return 0;
+}
+
+static int opt_no_demangle(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->flags &= ~(FLAG_DEMANGLE | FLAG_DEMANGLE_SORT);
+    return 0;
+}
+
+// Orders symbols by their demangled names instead of the mangled ones nm
+// sorts by.
+static int opt_demangled_sort(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->flags |= FLAG_DEMANGLE | FLAG_DEMANGLE_SORT;
+    return 0;
+}
+
+static int opt_diff(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->diff = true;
+    return 0;
+}
+
+static int opt_watch(struct nm_options *opts, char *value) {
+    if (!value || !ft_strcmp(value, "full")) {
+        opts->watch = WATCH_FULL;
+    } else if (!ft_strcmp(value, "changes")) {
+        opts->watch = WATCH_CHANGES;
+    } else {
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid watch mode '%s'\n", value);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int opt_numeric_sort(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->flags |= FLAG_NUMERIC_SORT;
+    return 0;
+}
+
+static int opt_size_sort(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->flags |= FLAG_SIZE_SORT;
+    return 0;
+}
+
+static int opt_print_size(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->flags |= FLAG_PRINT_SIZE;
+    return 0;
+}
+
+// --top=K[,by=size|value][,per=member|archive]. Ranking by size or value
+// also shows the listing the way --size-sort or -n would.
+static int opt_top(struct nm_options *opts, char *value) {
+    const char *iter = value;
+    size_t top = 0;
+
+    for (; ft_isdigit(*iter); iter++) {
+        top = top * 10 + (*iter - '0');
+    }
+
+    int by = FLAG_SIZE_SORT;
+    bool valid = top > 0;
+
+    while (valid && *iter == ',') {
+        const char *word = ++iter;
+
+        while (*iter && *iter != ',') {
+            iter++;
+        }
+
+        size_t len = iter - word;
+
+        if (len == 7 && !ft_strncmp(word, "by=size", 7)) {
+            by = FLAG_SIZE_SORT;
+        } else if (len == 8 && !ft_strncmp(word, "by=value", 8)) {
+            by = FLAG_NUMERIC_SORT;
+        } else if (len == 10 && !ft_strncmp(word, "per=member", 10)) {
+            opts->top_merged = false;
+        } else if (len == 11 && !ft_strncmp(word, "per=archive", 11)) {
+            opts->top_merged = true;
+        } else {
+            valid = false;
+        }
+    }
+
+    if (!valid || *iter) {
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid top selection '%s'\n", value);
+        return 1;
+    }
+
+    opts->top = top;
+    opts->flags = (opts->flags & ~(FLAG_SIZE_SORT | FLAG_NUMERIC_SORT)) | by;
+
+    return 0;
+}
+
+static int opt_match(struct nm_options *opts, char *value) {
+    return file_list_push(&opts->filter.globs, value);
+}
+
+static int opt_regex(struct nm_options *opts, char *value) {
+    return file_list_push(&opts->filter.regexes, value);
+}
+
+static int opt_section(struct nm_options *opts, char *value) {
+    return file_list_push(&opts->filter.sections, value);
+}
+
+static int opt_defined_only(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->filter.defined_only = true;
+    return 0;
+}
+
+// --type=LETTERS keeps the symbols printed with one of the type letters.
+static int opt_type(struct nm_options *opts, char *value) {
+    if (!*value) {
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid type selection '%s'\n", value);
+        return 1;
+    }
+
+    for (const char *iter = value; *iter; iter++) {
+        opts->filter.types[(unsigned char) *iter] = true;
+    }
+
+    opts->filter.typed = true;
+
+    return 0;
+}
+
+// --bind=local,global,weak, any of them.
+static int opt_bind(struct nm_options *opts, char *value) {
+    const char *iter = value;
+    bool valid = true;
+
+    while (valid) {
+        const char *word = iter;
+
+        while (*iter && *iter != ',') {
+            iter++;
+        }
+
+        size_t len = iter - word;
+
+        if (len == 5 && !ft_strncmp(word, "local", 5)) {
+            opts->filter.binds |= FILTER_BIND_LOCAL;
+        } else if (len == 6 && !ft_strncmp(word, "global", 6)) {
+            opts->filter.binds |= FILTER_BIND_GLOBAL;
+        } else if (len == 4 && !ft_strncmp(word, "weak", 4)) {
+            opts->filter.binds |= FILTER_BIND_WEAK;
+        } else {
+            valid = false;
+        }
+
+        if (!*iter++) {
+            break;
+        }
+    }
+
+    if (!valid) {
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid binding '%s'\n", value);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int opt_files_from(struct nm_options *opts, char *value) {
+    opts->files_from = value;
+    return 0;
+}
+
+static int opt_format(struct nm_options *opts, char *value) {
+    if (!ft_strcmp(value, "text") || !ft_strcmp(value, "bsd")) {
+        opts->format = FORMAT_TEXT;
+    } else if (!ft_strcmp(value, "jsonl")) {
+        opts->format = FORMAT_JSONL;
+    } else if (!ft_strcmp(value, "bin")) {
+        opts->format = FORMAT_BIN;
+    } else {
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid output format '%s'\n", value);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int opt_has(struct nm_options *opts, char *value) {
+    char *name = ft_strdup(value);
+
+    if (!name || file_list_push(&opts->has, name)) {
+        ft_free(name);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int opt_has_from(struct nm_options *opts, char *value) {
+    if (file_list_read(&opts->has, value, '\n')) {
+        ft_dprintf(STDERR_FILENO, "ft_nm: %s: unable to read symbol list\n", value);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int opt_recursive(struct nm_options *opts, char *value) {
+    return file_list_push(&opts->recursive, value);
+}
+
+static int opt_null(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->null_separated = true;
+    return 0;
+}
+
+static int opt_server(struct nm_options *opts, char *value) {
+    (void) value;
+    opts->server = true;
+    return 0;
+}
+
+static int opt_stats(struct nm_options *opts, char *value) {
+    if (!value) {
+        opts->stats = STATS_TEXT;
+    } else if (!ft_strcmp(value, "json")) {
+        opts->stats = STATS_JSON;
+    } else {
+        ft_dprintf(STDERR_FILENO, "ft_nm: invalid stats format '%s'\n", value);
+        return 1;
+    }
+
+    return 0;
+}
+
+static const struct long_option long_options[] = {
+    {"bind", LONG_REQUIRED_ARG, &opt_bind},
+    {"lookup", LONG_REQUIRED_ARG, &opt_lookup},
+    {"lookup-details", LONG_NO_ARG, &opt_lookup_details},
+    {"cache-dir", LONG_REQUIRED_ARG, &opt_cache_dir},
+    {"cache-size", LONG_REQUIRED_ARG, &opt_cache_size},
+    {"cache-stats", LONG_NO_ARG, &opt_cache_stats},
+    {"demangle", LONG_OPTIONAL_ARG, &opt_demangle},
+    {"no-demangle", LONG_NO_ARG, &opt_no_demangle},
+    {"defined-only", LONG_NO_ARG, &opt_defined_only},
+    {"demangled-sort", LONG_NO_ARG, &opt_demangled_sort},
+    {"diff", LONG_NO_ARG, &opt_diff},
+    {"files-from", LONG_REQUIRED_ARG, &opt_files_from},
+    {"format", LONG_REQUIRED_ARG, &opt_format},
+    {"has", LONG_REQUIRED_ARG, &opt_has},
+    {"has-from", LONG_REQUIRED_ARG, &opt_has_from},
+    {"match", LONG_REQUIRED_ARG, &opt_match},
+    {"memory-limit", LONG_REQUIRED_ARG, &opt_memory_limit},
+    {"null", LONG_NO_ARG, &opt_null},
+    {"numeric-sort", LONG_NO_ARG, &opt_numeric_sort},
+    {"print-size", LONG_NO_ARG, &opt_print_size},
+    {"recursive", LONG_REQUIRED_ARG, &opt_recursive},
+    {"regex", LONG_REQUIRED_ARG, &opt_regex},
+    {"section", LONG_REQUIRED_ARG, &opt_section},
+    {"server", LONG_NO_ARG, &opt_server},
+    {"size-sort", LONG_NO_ARG, &opt_size_sort},
+    {"stats", LONG_OPTIONAL_ARG, &opt_stats},
+    {"top", LONG_REQUIRED_ARG, &opt_top},
+    {"type", LONG_REQUIRED_ARG, &opt_type},
+    {"watch", LONG_OPTIONAL_ARG, &opt_watch},
+    {0, 0, 0}
+};
+
+static int apply_long_option(struct nm_options *opts, int argc, char **argv, int *i) {
+    char *name = argv[*i] + 2, *value = ft_strchr(name, '=');
+    size_t len = value ? (size_t) (value - name) : ft_strlen(name);
+
+    for (const struct long_option *opt = &long_options[0]; opt->name; opt++) {
+        if (ft_strlen(opt->name) != len || ft_strncmp(opt->name, name, len)) {
+            continue;
+        }
+
+        if (value) {
+            value++;
+        }
+
+        if (value && opt->arg == LONG_NO_ARG) {
+            ft_dprintf(STDERR_FILENO, "ft_nm: option '--%s' doesn't allow an argument\n", opt->name);
+            return 1;
+        }
+
+        if (!value && opt->arg == LONG_REQUIRED_ARG) {
+            if (*i + 1 >= argc) {
+                ft_dprintf(STDERR_FILENO, "ft_nm: option '--%s' requires an argument\n", opt->name);
+                return 1;
+            }
+
+            value = argv[++*i];
+        }
+
+        return opt->apply(opts, value);
+    }
+
+    ft_dprintf(STDERR_FILENO, "ft_nm: unrecognized option '%s'\n", argv[*i]);
+
+    return 1;
+}
+
+// Long options are not understood by ft_getopt_arg, so they are consumed
+// first and the remaining arguments are compacted for the short option pass.
+static int parse_long_options(struct nm_options *opts, int *argc, char **argv) {
+    int kept = 1;
+
+    for (int i = 1; i < *argc; i++) {
+        if (!ft_strcmp(argv[i], "--")) {
+            while (i < *argc) {
+                argv[kept++] = argv[i++];
+            }
+
+            break;
+        }
+
+        if (ft_strncmp(argv[i], "--", 2)) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+
+        if (apply_long_option(opts, *argc, argv, &i)) {
+            return 1;
+        }
+    }
+
+    *argc = kept;
+    argv[kept] = NULL;
+
+    return 0;
+}
+
+// Replaces every "@file" argument with the lines of that file, one argument
+// per line. Like binutils, an unreadable file leaves the argument as is.
+static int expand_response_files(struct nm_options *opts, int *argc, char ***argv) {
+    for (int i = 0; i < *argc; i++) {
+        char *arg = (*argv)[i];
+        size_t first = opts->response_words.count;
+
+        if (i == 0 || arg[0] != '@' || file_list_read(&opts->response_words, arg + 1, '\n')) {
+            if (file_list_push(&opts->args, arg)) {
+                return 1;
+            }
+
+            continue;
+        }
+
+        for (size_t word = first; word < opts->response_words.count; word++) {
+            if (file_list_push(&opts->args, opts->response_words.files[word])) {
+                return 1;
+            }
+        }
+    }
+
+    // parse_long_options() terminates the compacted vector in place.
+    if (file_list_push(&opts->args, NULL)) {
+        return 1;
+    }
+
+    *argc = opts->args.count - 1;
+    *argv = opts->args.files;
+
+    return 0;
+}
+
+int options_parse(struct nm_options *opts, int *argc, char ***argv) {
+    int ch;
+    getopt_args_t args = FT_GETOPT_INITIALIAZER;
+
+    opts->flags = 0;
+    opts->threads = 1;
+    opts->lookup_count = 0;
+    opts->lookup_details = false;
+    opts->cache_dir = NULL;
+    opts->cache_size = NM_CACHE_DEFAULT_SIZE;
+    opts->cache_stats = false;
+    opts->files_from = NULL;
+    opts->null_separated = false;
+    opts->server = false;
+    opts->stats = STATS_OFF;
+    opts->format = FORMAT_TEXT;
+    opts->diff = false;
+    opts->watch = WATCH_OFF;
+    opts->top = 0;
+    opts->top_merged = false;
+    opts->memory_limit = 0;
+    opts->filter = (struct nm_filter){0};
+    opts->args = (struct file_list){0};
+    opts->response_words = (struct file_list){0};
+    opts->has = (struct file_list){0};
+    opts->recursive = (struct file_list){0};
+    opts->lookup = NULL;
+
+    if (expand_response_files(opts, argc, argv)) {
+        return 1;
+    }
+
+    if (!(opts->lookup = ft_malloc(*argc * sizeof(char *)))) {
+        return 1;
+    }
+
+    if (parse_long_options(opts, argc, *argv)) {
+        return 1;
+    }
+
+    while ((ch = ft_getopt_arg(*argc, *argv, "aCDgj:nprSuv", &args)) != EOF) {
+        switch (ch) {
+            case 'r':
+                if (opts->flags & FLAG_NO_SORT) {
+                    ft_printf("ft_nm: conflicting option -p\n");
+                    return 1;
+                }
+
+                opts->flags |= FLAG_REV_SORT;
+                break;
+
+            case 'p':
+                if (opts->flags & FLAG_REV_SORT) {
+                    ft_printf("ft_nm: conflicting option -r\n");
+                    return 1;
+                }
+
+                opts->flags |= FLAG_NO_SORT;
+                break;
+
+            case 'u':
+                opts->flags |= FLAG_UNDEFINED_ONLY;
+                break;
+
+            case 'n':
+            case 'v':
+                opts->flags |= FLAG_NUMERIC_SORT;
+                break;
+
+            case 'S':
+                opts->flags |= FLAG_PRINT_SIZE;
+                break;
+
+            case 'g':
+                opts->flags |= FLAG_EXTERN_ONLY;
+                break;
+
+            case 'a':
+                opts->flags |= FLAG_DEBUG_SYMBOLS;
+                break;
+
+            case 'C':
+                opts->flags |= FLAG_DEMANGLE;
+                break;
+
+            case 'D':
+                opts->flags |= FLAG_DYNAMIC;
+                break;
+
+            case 'j':
+                opts->threads = ft_atoi(args.optarg);
+
+                if (opts->threads < 1) {
+                    ft_printf("ft_nm: invalid job count %s\n", args.optarg);
+                    return 1;
+                }
+
+                break;
+
+            default:
+                return 1;
+        }
+    }
+
+    *argc -= args.optind;
+    *argv += args.optind;
+
+    return filter_compile(&opts->filter);
+}
+
+void options_free(struct nm_options *opts) {
+    ft_free(opts->lookup);
+    opts->lookup = NULL;
+    file_list_free(&opts->args, opts->args.count);
+    file_list_free(&opts->response_words, 0);
+    file_list_free(&opts->has, 0);
+    file_list_free(&opts->recursive, opts->recursive.count);
+    filter_free(&opts->filter);
+}
@@ -0,0 +1,255 @@
+#include <errno.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+#define OUTPUT_MIN_CAP    4096
+#define OUTPUT_BUFFER_CAP (1 << 20)
+
+static const char hex_digits[16] = "0123456789abcdef";
+
+void output_init(struct nm_output *out, int fd) {
+    out->data = NULL;
+    out->len = 0;
+    out->cap = 0;
+    out->fd = fd;
+}
+
+static int output_writev(int fd, struct iovec *iov, int count) {
+    while (count) {
+        ssize_t ret = writev(fd, iov, count);
+
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        }
+
+        if (ret <= 0) {
+            return 1;
+        }
+
+        while (count && (size_t) ret >= iov->iov_len) {
+            ret -= iov->iov_len;
+            iov++;
+            count--;
+        }
+
+        if (count) {
+            iov->iov_base = (char *) iov->iov_base + ret;
+            iov->iov_len -= ret;
+        }
+    }
+
+    return 0;
+}
+
+// Descriptor-backed outputs hold at most OUTPUT_BUFFER_CAP bytes and drain
+// when full; in-memory outputs simply grow.
+static int output_reserve(struct nm_output *out, size_t len) {
+    if (out->len + len <= out->cap) {
+        return 0;
+    }
+
+    if (out->fd >= 0 && out->len) {
+        output_flush(out);
+
+        if (len <= out->cap) {
+            return 0;
+        }
+    }
+
+    size_t cap = out->cap ? out->cap : out->fd >= 0 ? OUTPUT_BUFFER_CAP : OUTPUT_MIN_CAP;
+
+    while (cap < out->len + len) {
+        cap *= 2;
+    }
+
+    char *data = ft_malloc(cap);
+
+    if (!data) {
+        return ERR_NO_MEM;
+    }
+
+    if (out->data) {
+        ft_memcpy(data, out->data, out->len);
+        ft_free(out->data);
+    }
+
+    out->data = data;
+    out->cap = cap;
+
+    return 0;
+}
+
+char *output_claim(struct nm_output *out, size_t len) {
+    if (output_reserve(out, len)) {
+        return NULL;
+    }
+
+    char *ptr = out->data + out->len;
+    out->len += len;
+
+    return ptr;
+}
+
+// Writes `data` after the pending bytes. Descriptor-backed outputs hand it
+// to writev() as is; in-memory ones have to copy it.
+int output_direct(struct nm_output *out, const char *data, size_t len) {
+    if (out->fd < 0) {
+        return output_append(out, data, len);
+    }
+
+    struct iovec iov[2] = {
+        {.iov_base = out->data, .iov_len = out->len},
+        {.iov_base = (void *) data, .iov_len = len},
+    };
+
+    out->len = 0;
+
+    return output_writev(out->fd, iov, 2);
+}
+
+int output_append(struct nm_output *out, const char *data, size_t len) {
+    // Large blocks (merged worker buffers, mostly) go straight to the
+    // descriptor together with whatever is pending instead of being copied.
+    if (out->fd >= 0 && len >= OUTPUT_BUFFER_CAP / 2) {
+        return output_direct(out, data, len);
+    }
+
+    if (output_reserve(out, len)) {
+        return ERR_NO_MEM;
+    }
+
+    ft_memcpy(out->data + out->len, data, len);
+    out->len += len;
+
+    return 0;
+}
+
+int output_printf(struct nm_output *out, const char *format, ...) {
+    va_list args;
+
+    va_start(args, format);
+    int len = vsnprintf(NULL, 0, format, args);
+    va_end(args);
+
+    if (len < 0 || output_reserve(out, len + 1)) {
+        return ERR_NO_MEM;
+    }
+
+    va_start(args, format);
+    vsnprintf(out->data + out->len, len + 1, format, args);
+    va_end(args);
+
+    out->len += len;
+
+    return 0;
+}
+
+int output_flush(struct nm_output *out) {
+    if (out->fd < 0 || !out->len) {
+        return 0;
+    }
+
+    struct iovec iov = {.iov_base = out->data, .iov_len = out->len};
+
+    out->len = 0;
+
+    return output_writev(out->fd, &iov, 1);
+}
+
+void output_hex64(char *dst, unsigned long value) {
+    for (int i = 15; i >= 0; i--) {
+        dst[i] = hex_digits[value & 0xf];
+        value >>= 4;
+    }
+}
+
+// Length of the well-formed UTF-8 sequence at `str`, or 0: overlong forms,
+// surrogates and code points past U+10FFFF do not count.
+static size_t utf8_sequence(const unsigned char *str, size_t len) {
+    size_t need = str[0] >= 0xf0 ? 4 : str[0] >= 0xe0 ? 3 : 2;
+    unsigned char lo = 0x80, hi = 0xbf;
+
+    if (str[0] < 0xc2 || str[0] > 0xf4 || len < need) {
+        return 0;
+    }
+
+    if (str[0] == 0xe0) {
+        lo = 0xa0;
+    } else if (str[0] == 0xed) {
+        hi = 0x9f;
+    } else if (str[0] == 0xf0) {
+        lo = 0x90;
+    } else if (str[0] == 0xf4) {
+        hi = 0x8f;
+    }
+
+    if (str[1] < lo || str[1] > hi) {
+        return 0;
+    }
+
+    for (size_t i = 2; i < need; i++) {
+        if ((str[i] & 0xc0) != 0x80) {
+            return 0;
+        }
+    }
+
+    return need;
+}
+
+// Writes `str` as a quoted JSON string. Names are arbitrary bytes: valid
+// UTF-8 is copied as is, and any other byte is escaped as the code point of
+// the same value (\u0080 to \u00ff, as if it were Latin-1), so the line
+// stays valid JSON and the byte can still be told back.
+int output_json_string(struct nm_output *out, const char *str, size_t len) {
+    char *dst = output_claim(out, 2 + len * 6);
+
+    if (!dst) {
+        return ERR_NO_MEM;
+    }
+
+    char *start = dst;
+    *dst++ = '"';
+
+    for (size_t i = 0, n; i < len; i++) {
+        unsigned char c = str[i];
+
+        if (c == '"' || c == '\\') {
+            *dst++ = '\\';
+            *dst++ = c;
+        } else if (c >= 0x80 && (n = utf8_sequence((const unsigned char *) str + i, len - i))) {
+            ft_memcpy(dst, str + i, n);
+            dst += n;
+            i += n - 1;
+        } else if (c < 0x20 || c >= 0x80) {
+            ft_memcpy(dst, "\\u00", 4);
+            dst[4] = hex_digits[c >> 4];
+            dst[5] = hex_digits[c & 0xf];
+            dst += 6;
+        } else {
+            *dst++ = c;
+        }
+    }
+
+    *dst++ = '"';
+
+    // Give back what the worst case reserved but did not use.
+    out->len -= 2 + len * 6 - (dst - start);
+
+    return 0;
+}
+
+// Drops the pending bytes but keeps the buffer for reuse.
+void output_reset(struct nm_output *out) {
+    out->len = 0;
+}
+
+void output_free(struct nm_output *out) {
+    ft_free(out->data);
+    output_init(out, out->fd);
+}
@@ -0,0 +1,225 @@
+#include <libft/stdlib.h>
+#include <pthread.h>
+
+#include "ft_nm.h"
+
+struct pool_job {
+    struct nm_context ctx;
+    int result;
+    bool done;
+};
+
+struct worker_pool {
+    pthread_t *threads;
+    size_t thread_count;
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+    struct pool_job *jobs;
+    size_t job_count;
+    size_t next_job;
+    // Jobs below this one have been merged. Workers stay within `window`
+    // jobs of it, so output waiting for the printer stays bounded when an
+    // early job is slow.
+    size_t merged;
+    size_t window;
+    pool_job_t run;
+    void *arg;
+    bool stopping;
+};
+
+static void *pool_worker(void *data) {
+    struct worker_pool *pool = data;
+    struct symbol_table symbols;
+    struct demangle_cache *demangle = NULL;
+
+    symbol_table_init(&symbols);
+    pthread_mutex_lock(&pool->lock);
+
+    while (true) {
+        while (!pool->stopping && (pool->next_job >= pool->job_count || pool->next_job >= pool->merged + pool->window)) {
+            pthread_cond_wait(&pool->work_cond, &pool->lock);
+        }
+
+        if (pool->stopping) {
+            break;
+        }
+
+        size_t index = pool->next_job++;
+        struct pool_job *job = &pool->jobs[index];
+        pool_job_t run = pool->run;
+        void *arg = pool->arg;
+
+        pthread_mutex_unlock(&pool->lock);
+
+        // The symbol arena belongs to the thread rather than the job, so a
+        // worker stays allocation-free once it has seen its largest table.
+        // The demangle cache follows it, so names repeated across files are
+        // demangled once per thread.
+        job->ctx.symbols = symbols;
+        job->ctx.demangle = demangle;
+        int result = run(&job->ctx, arg, index);
+        symbols = job->ctx.symbols;
+        demangle = job->ctx.demangle;
+        symbol_table_init(&job->ctx.symbols);
+        job->ctx.demangle = NULL;
+
+        pthread_mutex_lock(&pool->lock);
+
+        job->result = result;
+        job->done = true;
+        pthread_cond_broadcast(&pool->done_cond);
+    }
+
+    pthread_mutex_unlock(&pool->lock);
+    symbol_table_free(&symbols);
+    demangle_free(demangle);
+
+    return NULL;
+}
+
+struct worker_pool *pool_create(size_t thread_count) {
+    struct worker_pool *pool = ft_malloc(sizeof(struct worker_pool));
+
+    if (!pool) {
+        return NULL;
+    }
+
+    pool->threads = ft_malloc(thread_count * sizeof(pthread_t));
+
+    if (!pool->threads) {
+        ft_free(pool);
+        return NULL;
+    }
+
+    pool->thread_count = 0;
+    pool->jobs = NULL;
+    pool->job_count = 0;
+    pool->next_job = 0;
+    pool->merged = 0;
+    pool->window = 2 * thread_count;
+    pool->run = NULL;
+    pool->arg = NULL;
+    pool->stopping = false;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_cond, NULL);
+    pthread_cond_init(&pool->done_cond, NULL);
+
+    for (size_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&pool->threads[i], NULL, &pool_worker, pool)) {
+            break;
+        }
+
+        pool->thread_count++;
+    }
+
+    if (!pool->thread_count) {
+        pool_destroy(pool);
+        return NULL;
+    }
+
+    return pool;
+}
+
+static void pool_merge(struct nm_context *parent, struct pool_job *job) {
+    output_append(&parent->out, job->ctx.out.data, job->ctx.out.len);
+
+    if (job->ctx.err.len) {
+        output_flush(&parent->out);
+        output_append(&parent->err, job->ctx.err.data, job->ctx.err.len);
+        output_flush(&parent->err);
+    }
+
+    if (parent->capturing) {
+        cache_writer_merge(&parent->capture, &job->ctx.capture);
+    }
+
+    parent->errors += job->ctx.errors;
+
+    if (parent->opts->stats) {
+        stats_merge(&parent->stats, &job->ctx.stats);
+        stats_merge(&parent->stats_total, &job->ctx.stats_total);
+    }
+
+    context_free(&job->ctx);
+}
+
+// Runs `count` jobs on the pool and merges their buffered output into the
+// parent context strictly in index order, so the result is byte-identical
+// to calling `run` for each index in turn. At most two jobs per thread are
+// ahead of the merge at any time.
+int pool_run(struct worker_pool *pool, struct nm_context *parent, size_t count, pool_job_t run, void *arg) {
+    int result = 0;
+
+    if (!pool || count < 2) {
+        for (size_t i = 0; i < count; i++) {
+            result |= run(parent, arg, i);
+        }
+
+        return result;
+    }
+
+    struct pool_job *jobs = ft_malloc(count * sizeof(struct pool_job));
+
+    if (!jobs) {
+        return ERR_NO_MEM;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        context_fork(parent, &jobs[i].ctx);
+        jobs[i].result = 0;
+        jobs[i].done = false;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->jobs = jobs;
+    pool->job_count = count;
+    pool->next_job = 0;
+    pool->merged = 0;
+    pool->run = run;
+    pool->arg = arg;
+    pthread_cond_broadcast(&pool->work_cond);
+
+    for (size_t i = 0; i < count; i++) {
+        while (!jobs[i].done) {
+            pthread_cond_wait(&pool->done_cond, &pool->lock);
+        }
+
+        pthread_mutex_unlock(&pool->lock);
+        result |= jobs[i].result;
+        pool_merge(parent, &jobs[i]);
+        pthread_mutex_lock(&pool->lock);
+        pool->merged = i + 1;
+        pthread_cond_broadcast(&pool->work_cond);
+    }
+
+    pool->jobs = NULL;
+    pool->job_count = 0;
+    pool->next_job = 0;
+    pthread_mutex_unlock(&pool->lock);
+
+    ft_free(jobs);
+
+    return result;
+}
+
+void pool_destroy(struct worker_pool *pool) {
+    if (!pool) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->work_cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (size_t i = 0; i < pool->thread_count; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work_cond);
+    pthread_cond_destroy(&pool->done_cond);
+    ft_free(pool->threads);
+    ft_free(pool);
+}
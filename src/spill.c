@@ -0,0 +1,314 @@
+#include <errno.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+// Runs shorter than this would make the merge read a handful of entries at a
+// time; the limit is exceeded by that much rather than crawl.
+#define SPILL_MIN_RUN 4096
+
+// Sorted runs of one table, written back to back to an unlinked temporary
+// file. Entries are stored as they are, names included as pointers: the file
+// is read back by this process while the input is still mapped.
+struct nm_spill {
+    int fd;
+    size_t *runs;
+    size_t run_count;
+    size_t runs_cap;
+    size_t written;
+};
+
+// Where a run stands during the merge: `buffer` holds the entries read ahead,
+// `left` those still in the file after them.
+struct spill_cursor {
+    struct symbol_entry *buffer;
+    size_t pos;
+    size_t len;
+    size_t offset;
+    size_t left;
+};
+
+static ssize_t spill_io(int fd, void *buf, size_t len, off_t offset, bool writing) {
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t ret = writing ? pwrite(fd, (char *) buf + done, len - done, offset + done) : pread(fd, (char *) buf + done, len - done, offset + done);
+
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        } else if (ret <= 0) {
+            return -1;
+        }
+
+        done += ret;
+    }
+
+    return done;
+}
+
+static int spill_open(void) {
+    const char *dir = getenv("TMPDIR");
+    char path[4096];
+
+    snprintf(path, sizeof(path), "%s/ft_nm.XXXXXX", dir && *dir ? dir : "/tmp");
+
+    int fd = mkstemp(path);
+
+    if (fd >= 0) {
+        unlink(path);
+    }
+
+    return fd;
+}
+
+// Lets the table being listed sort through temporary files when it and the
+// sort's scratch would not fit in its share of --memory-limit.
+int spill_begin(struct nm_context *ctx) {
+    struct nm_spill *spill = ft_malloc(sizeof(struct nm_spill));
+
+    if (!spill) {
+        return ERR_NO_MEM;
+    }
+
+    ft_bzero(spill, sizeof(*spill));
+    spill->fd = -1;
+    ctx->spill = spill;
+
+    return 0;
+}
+
+// How many entries a run may hold for a table of `entries` symbols, or 0 when
+// the whole table fits.
+size_t spill_capacity(const struct nm_context *ctx, size_t entries) {
+    size_t budget = ctx->opts->memory_limit / ctx->opts->threads, entry = 2 * sizeof(struct symbol_entry);
+
+    if (!ctx->spill || entries <= budget / entry) {
+        return 0;
+    }
+
+    return budget / entry > SPILL_MIN_RUN ? budget / entry : SPILL_MIN_RUN;
+}
+
+bool spill_pending(const struct nm_context *ctx) {
+    return ctx->spill && ctx->spill->run_count;
+}
+
+// Hands over a full table: -p prints it as it is, otherwise it is sorted and
+// written out as the next run. Either way the table is empty afterwards.
+int spill_run(struct nm_context *ctx, struct symbol_table *table) {
+    struct nm_spill *spill = ctx->spill;
+
+    if (ctx->flags & FLAG_NO_SORT) {
+        print_symbols(ctx, table);
+        table->count = 0;
+        return 0;
+    }
+
+    if (ctx->flags & FLAG_DEMANGLE_SORT) {
+        demangle_table(ctx, table);
+    }
+
+    if (symbol_table_sort(table, ctx->flags)) {
+        return ERR_NO_MEM;
+    }
+
+    if (!table->count) {
+        return 0;
+    }
+
+    if (spill->run_count == spill->runs_cap) {
+        size_t cap = spill->runs_cap ? spill->runs_cap * 2 : 16;
+        size_t *runs = ft_malloc(cap * sizeof(size_t));
+
+        if (!runs) {
+            return ERR_NO_MEM;
+        }
+
+        if (spill->run_count) {
+            ft_memcpy(runs, spill->runs, spill->run_count * sizeof(size_t));
+        }
+
+        ft_free(spill->runs);
+        spill->runs = runs;
+        spill->runs_cap = cap;
+    }
+
+    if (spill->fd < 0 && (spill->fd = spill_open()) < 0) {
+        context_error(ctx, "ft_nm: unable to create temporary file: %s\n", strerror(errno));
+        return ERR_IO;
+    }
+
+    size_t len = table->count * sizeof(struct symbol_entry);
+
+    if (spill_io(spill->fd, table->entries, len, spill->written * sizeof(struct symbol_entry), true) < 0) {
+        context_error(ctx, "ft_nm: unable to write temporary file: %s\n", strerror(errno));
+        return ERR_IO;
+    }
+
+    spill->runs[spill->run_count++] = table->count;
+    spill->written += table->count;
+    table->count = 0;
+
+    return 0;
+}
+
+static int spill_fill(struct nm_spill *spill, struct spill_cursor *cursor, size_t slot) {
+    size_t len = cursor->left < slot ? cursor->left : slot;
+
+    if (spill_io(spill->fd, cursor->buffer, len * sizeof(struct symbol_entry), cursor->offset * sizeof(struct symbol_entry), false) < 0) {
+        return 1;
+    }
+
+    cursor->pos = 0;
+    cursor->len = len;
+    cursor->offset += len;
+    cursor->left -= len;
+
+    return 0;
+}
+
+// The run whose head goes first, the earlier run on a tie: runs were cut
+// from the symbol table in order, so that is the order a single sort keeps.
+static bool spill_before(const struct spill_cursor *cursors, size_t lhs, size_t rhs, int flags) {
+    int cmp = symbol_compare(&cursors[lhs].buffer[cursors[lhs].pos], &cursors[rhs].buffer[cursors[rhs].pos], flags);
+
+    if (flags & FLAG_REV_SORT) {
+        cmp = -cmp;
+    }
+
+    return cmp ? cmp < 0 : lhs < rhs;
+}
+
+static void spill_sift_down(const struct spill_cursor *cursors, size_t *heap, size_t count, size_t i, int flags) {
+    while (true) {
+        size_t first = i, left = 2 * i + 1, right = left + 1;
+
+        if (left < count && spill_before(cursors, heap[left], heap[first], flags)) {
+            first = left;
+        }
+
+        if (right < count && spill_before(cursors, heap[right], heap[first], flags)) {
+            first = right;
+        }
+
+        if (first == i) {
+            return;
+        }
+
+        size_t tmp = heap[i];
+        heap[i] = heap[first];
+        heap[first] = tmp;
+        i = first;
+    }
+}
+
+// Merges the runs and prints them in batches. The table's entries and
+// scratch, no longer needed once everything is written out, are split
+// between one read-ahead buffer per run and the batch being printed.
+int spill_merge(struct nm_context *ctx) {
+    struct nm_spill *spill = ctx->spill;
+    struct symbol_table *table = &ctx->symbols;
+    size_t k = spill->run_count, slot = table->cap / k, count = k;
+    struct symbol_entry *buffers, *owned = NULL;
+    int err = 0;
+
+    if (!table->scratch && !(table->scratch = ft_malloc(table->cap * sizeof(struct symbol_entry)))) {
+        return ERR_NO_MEM;
+    }
+
+    buffers = table->scratch;
+
+    struct spill_cursor *cursors = ft_malloc(k * sizeof(struct spill_cursor));
+    size_t *heap = ft_malloc(k * sizeof(size_t));
+
+    // More runs than a table holds entries only happens with a limit far
+    // below SPILL_MIN_RUN; each run then reads one entry at a time.
+    if (!slot) {
+        buffers = owned = ft_malloc(k * sizeof(struct symbol_entry));
+        slot = 1;
+    }
+
+    if (!cursors || !heap || !buffers) {
+        err = ERR_NO_MEM;
+        goto err_out;
+    }
+
+    // The batch lives in the entries, the buffers in the scratch, so neither
+    // straddles the two allocations.
+    struct symbol_table batch = {.entries = table->entries};
+    size_t start = 0;
+
+    for (size_t i = 0; i < k; i++) {
+        cursors[i] = (struct spill_cursor){.buffer = buffers + i * slot, .offset = start, .left = spill->runs[i]};
+        start += spill->runs[i];
+
+        if (spill_fill(spill, &cursors[i], slot)) {
+            err = ERR_IO;
+            goto err_out;
+        }
+
+        heap[i] = i;
+    }
+
+    for (size_t i = k / 2; i-- > 0;) {
+        spill_sift_down(cursors, heap, k, i, ctx->flags);
+    }
+
+    while (count) {
+        struct spill_cursor *cursor = &cursors[heap[0]];
+
+        batch.entries[batch.count++] = cursor->buffer[cursor->pos++];
+
+        if (batch.count == table->cap) {
+            print_symbols(ctx, &batch);
+            batch.count = 0;
+        }
+
+        if (cursor->pos == cursor->len && cursor->left && spill_fill(spill, cursor, slot)) {
+            err = ERR_IO;
+            goto err_out;
+        }
+
+        if (cursor->pos == cursor->len) {
+            heap[0] = heap[--count];
+        }
+
+        spill_sift_down(cursors, heap, count, 0, ctx->flags);
+    }
+
+    if (batch.count) {
+        print_symbols(ctx, &batch);
+    }
+
+err_out:
+    if (err == ERR_IO) {
+        context_error(ctx, "ft_nm: unable to read temporary file: %s\n", strerror(errno));
+    }
+
+    ft_free(cursors);
+    ft_free(heap);
+    ft_free(owned);
+
+    return err;
+}
+
+void spill_end(struct nm_context *ctx) {
+    struct nm_spill *spill = ctx->spill;
+
+    if (!spill) {
+        return;
+    }
+
+    if (spill->fd >= 0) {
+        close(spill->fd);
+    }
+
+    ft_free(spill->runs);
+    ft_free(spill);
+    ctx->spill = NULL;
+}
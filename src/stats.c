@@ -0,0 +1,117 @@
+#define _GNU_SOURCE
+#include <libft/string.h>
+#include <stdio.h>
+#include <sys/resource.h>
+
+#include "ft_nm.h"
+
+static const char *phase_names[PHASE_COUNT] = {"map", "scan", "decode", "sort", "print"};
+
+static void stats_faults(unsigned long *minor, unsigned long *major, int who) {
+    struct rusage usage;
+
+    if (getrusage(who, &usage) < 0) {
+        *minor = 0;
+        *major = 0;
+        return;
+    }
+
+    *minor = usage.ru_minflt;
+    *major = usage.ru_majflt;
+}
+
+void stats_merge(struct nm_stats *dst, const struct nm_stats *src) {
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        dst->phase_ns[i] += src->phase_ns[i];
+    }
+
+    dst->files += src->files;
+    dst->symbols_seen += src->symbols_seen;
+    dst->skipped_file += src->skipped_file;
+    dst->skipped_name += src->skipped_name;
+    dst->skipped_type += src->skipped_type;
+    dst->skipped_filter += src->skipped_filter;
+    dst->allocated += src->allocated;
+    dst->printed += src->printed;
+    dst->bytes_mapped += src->bytes_mapped;
+    dst->minor_faults += src->minor_faults;
+    dst->major_faults += src->major_faults;
+}
+
+// Faults are sampled on the calling thread, so members decoded by other
+// pool threads only show up in the process-wide total.
+void stats_begin(struct nm_context *ctx) {
+    ft_bzero(&ctx->stats, sizeof(ctx->stats));
+    stats_faults(&ctx->stats.minor_faults, &ctx->stats.major_faults, RUSAGE_THREAD);
+
+    // Start from the negated counts so stats_end() is left with the delta.
+    ctx->stats.minor_faults = -ctx->stats.minor_faults;
+    ctx->stats.major_faults = -ctx->stats.major_faults;
+}
+
+void stats_end(struct nm_context *ctx, const char *file) {
+    unsigned long minor, major;
+
+    stats_faults(&minor, &major, RUSAGE_THREAD);
+    ctx->stats.minor_faults += minor;
+    ctx->stats.major_faults += major;
+    ctx->stats.files = 1;
+
+    stats_report(&ctx->err, ctx->opts->stats, file, &ctx->stats, 0);
+    context_flush_err(ctx);
+    stats_merge(&ctx->stats_total, &ctx->stats);
+    ft_bzero(&ctx->stats, sizeof(ctx->stats));
+}
+
+// Replaces the summed fault counts with the process-wide ones.
+void stats_finish(struct nm_stats *total) {
+    stats_faults(&total->minor_faults, &total->major_faults, RUSAGE_SELF);
+}
+
+static void report_text(struct nm_output *out, const char *label, const struct nm_stats *stats) {
+    output_printf(out, "ft_nm: stats: %s:", label);
+
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        output_printf(out, "%s %s %.3f ms", i ? "," : "", phase_names[i], stats->phase_ns[i] / 1e6);
+    }
+
+    output_printf(out, "\nft_nm: stats: %s: %zu symbols seen, %zu skipped (%zu STT_FILE, %zu bad names, %zu untyped, %zu filtered), %zu allocated, %zu printed\n",
+                  label, stats->symbols_seen, stats->skipped_file + stats->skipped_name + stats->skipped_type + stats->skipped_filter,
+                  stats->skipped_file, stats->skipped_name, stats->skipped_type, stats->skipped_filter, stats->allocated, stats->printed);
+    output_printf(out, "ft_nm: stats: %s: %zu bytes mapped, %lu minor faults, %lu major faults\n",
+                  label, stats->bytes_mapped, stats->minor_faults, stats->major_faults);
+}
+
+static void report_json(struct nm_output *out, const char *file, const struct nm_stats *stats, unsigned long wall_ns) {
+    if (file) {
+        output_printf(out, "{\"scope\":\"file\",\"file\":");
+        output_json_string(out, file, ft_strlen(file));
+    } else {
+        output_printf(out, "{\"scope\":\"total\",\"files\":%zu,\"wall_ns\":%lu", stats->files, wall_ns);
+    }
+
+    output_printf(out, ",\"phases_ns\":{");
+
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        output_printf(out, "%s\"%s\":%lu", i ? "," : "", phase_names[i], stats->phase_ns[i]);
+    }
+
+    output_printf(out, "},\"symbols\":{\"seen\":%zu,\"skipped_file\":%zu,\"skipped_name\":%zu,\"skipped_type\":%zu,\"skipped_filter\":%zu,\"allocated\":%zu,\"printed\":%zu}",
+                  stats->symbols_seen, stats->skipped_file, stats->skipped_name, stats->skipped_type, stats->skipped_filter, stats->allocated, stats->printed);
+    output_printf(out, ",\"bytes_mapped\":%zu,\"faults\":{\"minor\":%lu,\"major\":%lu}}\n",
+                  stats->bytes_mapped, stats->minor_faults, stats->major_faults);
+}
+
+// Writes one report; a NULL `file` is the aggregate over the whole run.
+void stats_report(struct nm_output *out, int format, const char *file, const struct nm_stats *stats, unsigned long wall_ns) {
+    if (format == STATS_JSON) {
+        report_json(out, file, stats, wall_ns);
+    } else if (file) {
+        report_text(out, file, stats);
+    } else {
+        char label[64];
+
+        snprintf(label, sizeof(label), "total (%zu files, %.3f ms wall)", stats->files, wall_ns / 1e6);
+        report_text(out, label, stats);
+    }
+}
@@ -0,0 +1,350 @@
+#define _GNU_SOURCE
+#include <ar.h>
+#include <errno.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+#define STREAM_MIN_CAP (1UL << 20)
+#define STREAM_HEAD    64
+
+static ssize_t stream_io(int fd, void *buf, size_t len, off_t offset, bool positioned) {
+    size_t done = 0;
+
+    while (done < len) {
+        ssize_t ret = positioned ? pread(fd, (char *) buf + done, len - done, offset + done) : read(fd, (char *) buf + done, len - done);
+
+        if (ret < 0 && errno == EINTR) {
+            continue;
+        } else if (ret < 0) {
+            return -1;
+        } else if (!ret) {
+            break;
+        }
+
+        done += ret;
+    }
+
+    return done;
+}
+
+// Anonymous and never touched past what is read, so sizing it after the whole
+// file costs address space only.
+static int stream_reserve(struct nm_stream *stream, size_t cap) {
+    void *mem = stream->mem ? mremap(stream->mem, stream->cap, cap, MREMAP_MAYMOVE)
+                            : mmap(NULL, cap, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if (mem == MAP_FAILED) {
+        return ERR_NO_MEM;
+    }
+
+    stream->mem = mem;
+    stream->cap = cap;
+
+    return 0;
+}
+
+// Reads [offset, offset + len) of a seekable input into the same place in the
+// mapping; ranges past the end are clamped.
+int stream_fetch(struct nm_stream *stream, size_t offset, size_t len) {
+    if (offset >= stream->size) {
+        return 0;
+    }
+
+    if (len > stream->size - offset) {
+        len = stream->size - offset;
+    }
+
+    if (stream_io(stream->fd, stream->mem + offset, len, offset, true) < 0) {
+        return 1;
+    }
+
+    stream->fetched += len;
+
+    return 0;
+}
+
+// Appends the rest of the input after what has been read so far.
+static int stream_slurp(struct nm_stream *stream) {
+    while (true) {
+        if (stream->size == stream->cap) {
+            if (stream->seekable || stream_reserve(stream, stream->cap * 2)) {
+                return stream->seekable ? 0 : ERR_NO_MEM;
+            }
+        }
+
+        ssize_t ret = stream_io(stream->fd, stream->mem + stream->size, stream->cap - stream->size, 0, false);
+
+        if (ret < 0) {
+            return 1;
+        } else if (!ret) {
+            return 0;
+        }
+
+        stream->size += ret;
+        stream->fetched += ret;
+    }
+}
+
+// Sequential reads drain the bytes already sitting in the mapping first.
+static ssize_t stream_read(struct nm_stream *stream, void *buf, size_t len) {
+    size_t pending = stream->size - stream->pos;
+
+    if (pending > len) {
+        pending = len;
+    }
+
+    ft_memcpy(buf, stream->mem + stream->pos, pending);
+    stream->pos += pending;
+
+    ssize_t ret = stream_io(stream->fd, (char *) buf + pending, len - pending, 0, false);
+
+    if (ret < 0) {
+        return -1;
+    }
+
+    stream->fetched += ret;
+
+    return pending + ret;
+}
+
+// Returns how many of the `len` bytes were skipped, or -1 on a read error.
+static ssize_t stream_skip(struct nm_stream *stream, size_t len) {
+    char scratch[4096];
+    size_t pending = stream->size - stream->pos, done;
+
+    if (pending > len) {
+        pending = len;
+    }
+
+    stream->pos += pending;
+    done = pending;
+
+    if (stream->seekable && done < len) {
+        off_t end = lseek(stream->fd, len - done, SEEK_CUR);
+
+        if (end < 0) {
+            return -1;
+        }
+
+        return (size_t) end > stream->cap ? len - ((size_t) end - stream->cap) : len;
+    }
+
+    while (done < len) {
+        size_t chunk = len - done < sizeof(scratch) ? len - done : sizeof(scratch);
+        ssize_t ret = stream_read(stream, scratch, chunk);
+
+        if (ret <= 0) {
+            return ret < 0 ? -1 : (ssize_t) done;
+        }
+
+        done += ret;
+    }
+
+    return done;
+}
+
+// Sets up `stream` for an input that cannot be mapped: a pipe, stdin, a
+// character device, or a file whose filesystem refuses mmap. Plain listings
+// of archives are left to stream_archive(); ELF files on seekable inputs only
+// get the ranges load_elf() needs; everything else is read whole.
+int stream_open(struct nm_context *ctx, struct nm_stream *stream, int fd, const struct stat *st) {
+    bool listing = !ctx->opts->lookup_count && !ctx->opts->has.count && !(ctx->flags & FLAG_DYNAMIC);
+
+    ft_bzero(stream, sizeof(*stream));
+    stream->fd = fd;
+    stream->seekable = S_ISREG(st->st_mode) && st->st_size > 0;
+
+    if (stream_reserve(stream, stream->seekable ? (size_t) st->st_size : STREAM_MIN_CAP)) {
+        return ERR_NO_MEM;
+    }
+
+    ssize_t head = stream_io(fd, stream->mem, stream->cap < STREAM_HEAD ? stream->cap : STREAM_HEAD, 0, false);
+
+    if (head < 0) {
+        return 1;
+    }
+
+    stream->size = head;
+    stream->fetched = head;
+
+    int class = parse_magic((char *) stream->mem, head);
+
+    if (listing && class == ARCH) {
+        stream->sequential = true;
+        return 0;
+    }
+
+    if (listing && stream->seekable && (class == ELF32 || class == ELF64)) {
+        stream->size = st->st_size;
+        stream_elf_ranges(stream);
+        return 0;
+    }
+
+    return stream_slurp(stream);
+}
+
+// Reads a member of `len` bytes into `*buf`, keeping `extra` bytes free after
+// it. The buffer grows with what actually arrives, so a header claiming more
+// than the input holds makes a short read rather than an allocation of that
+// size. `*done` is how many bytes were read; ERR_IO leaves the cause in errno.
+static int stream_member(struct nm_stream *stream, unsigned char **buf, size_t *cap, size_t len, size_t extra, size_t *done) {
+    *done = 0;
+
+    while (true) {
+        size_t room = *cap > extra ? *cap - extra : 0;
+
+        if (room > len) {
+            room = len;
+        }
+
+        if (*done == room && (room < len || *cap < len + extra)) {
+            size_t next = *cap * 2 > STREAM_MIN_CAP ? *cap * 2 : STREAM_MIN_CAP;
+            unsigned char *data = ft_malloc(next < len + extra ? next : len + extra);
+
+            if (!data) {
+                return ERR_NO_MEM;
+            }
+
+            if (*done) {
+                ft_memcpy(data, *buf, *done);
+            }
+
+            ft_free(*buf);
+            *buf = data;
+            *cap = next < len + extra ? next : len + extra;
+            continue;
+        }
+
+        if (*done == len) {
+            return 0;
+        }
+
+        ssize_t ret = stream_read(stream, *buf + *done, room - *done);
+
+        if (ret < 0) {
+            return ERR_IO;
+        }
+
+        *done += ret;
+
+        if (*done < room) {
+            return 0;
+        }
+    }
+}
+
+// Lists an archive front to back without ever holding more than one member:
+// the symbol index is skipped, the long name table is kept, and each member
+// is read, decoded and dropped in turn. Like archive_index_build(), member
+// sizes are taken as is, without the odd-size padding.
+int stream_archive(struct nm_context *ctx, struct nm_stream *stream) {
+    unsigned char *data = NULL, *long_names = NULL;
+    size_t cap = 0, long_cap = 0;
+    struct ar_hdr header;
+    ssize_t ret;
+    int err = 0, read_errno = 0;
+
+    stream->pos = SARMAG;
+
+    if (ctx->opts->top_merged && top_begin(ctx)) {
+        return ERR_NO_MEM;
+    }
+
+    // Offsets are counted here: stream->pos only covers what was prefetched.
+    for (size_t offset = SARMAG;;) {
+        if ((ret = stream_read(stream, &header, sizeof(header))) < 0) {
+            read_errno = errno;
+            break;
+        }
+
+        if ((size_t) ret < sizeof(header)) {
+            break;
+        }
+
+        struct archive_member member = {
+            .header = &header,
+            .offset = offset,
+        };
+
+        if (!archive_member_size(&header, &member.size)) {
+            member.name = archive_member_name(header.ar_name, (char *) long_names, &member.name_len);
+            member.class = ISERR;
+            archive_parse_member(ctx, &member);
+            err = 1;
+            break;
+        }
+
+        offset += sizeof(header) + member.size;
+
+        // The symbol index is only needed for --lookup and --has.
+        if (!ft_strncmp("/               ", header.ar_name, 16) || !ft_strncmp("/SYM64/         ", header.ar_name, 16)) {
+            if ((ret = stream_skip(stream, member.size)) < 0) {
+                read_errno = errno;
+                break;
+            }
+
+            if ((size_t) ret < member.size) {
+                err = 1;
+                break;
+            }
+
+            continue;
+        }
+
+        member.name = archive_member_name(header.ar_name, (char *) long_names, &member.name_len);
+
+        bool is_long_names = !long_names && !ft_strncmp("//              ", header.ar_name, 16);
+
+        size_t got;
+        int status = is_long_names ? stream_member(stream, &long_names, &long_cap, member.size, 1, &got) : stream_member(stream, &data, &cap, member.size, 0, &got);
+
+        member.data = is_long_names ? long_names : data;
+
+        if (status == ERR_IO) {
+            read_errno = errno;
+            break;
+        } else if (status) {
+            err = status;
+            break;
+        }
+
+        if (got < member.size) {
+            member.class = ISERR;
+            archive_parse_member(ctx, &member);
+            err = 1;
+            break;
+        }
+
+        if (is_long_names) {
+            long_names[member.size] = '\0';
+            continue;
+        }
+
+        member.class = parse_magic((char *) member.data, member.size);
+        archive_parse_member(ctx, &member);
+    }
+
+    if (read_errno) {
+        context_error(ctx, "Unable to read file: %s\n", strerror(read_errno));
+        err = 1;
+    }
+
+    top_end(ctx);
+    ft_free(data);
+    ft_free(long_names);
+
+    return err;
+}
+
+void stream_close(struct nm_stream *stream) {
+    if (stream->mem) {
+        munmap(stream->mem, stream->cap);
+    }
+
+    ft_bzero(stream, sizeof(*stream));
+}
@@ -0,0 +1,176 @@
+#include <libft/string.h>
+#include <stdint.h>
+
+#include "ft_nm.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Name kernels: bounded length over a string table, first mismatch and
+// ordering of two names whose lengths are known. x86-64 starts on SSE2,
+// which every such CPU has, and strings_init() moves to AVX2 when the CPU
+// supports it; everything else runs the scalar versions.
+//
+// The length scans load whole aligned blocks, which may read past the end of
+// the string or before its start but never into another page.
+
+static size_t scalar_len(const char *s) {
+    return ft_strlen(s);
+}
+
+static size_t scalar_nlen(const char *s, size_t max) {
+    return ft_strnlen(s, max);
+}
+
+static size_t scalar_mismatch(const char *a, const char *b, size_t len) {
+    size_t i = 0;
+
+    while (i < len && a[i] == b[i]) {
+        i++;
+    }
+
+    return i;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((no_sanitize_address)) static size_t sse2_nlen(const char *s, size_t max) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t align = (uintptr_t) s & 15;
+    const char *base = s - align;
+    unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) base), zero)) >> align;
+    size_t offset = 0;
+
+    while (!mask) {
+        base += 16;
+        offset = base - s;
+
+        if (offset >= max) {
+            return max;
+        }
+
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128((const __m128i *) base), zero));
+    }
+
+    size_t len = offset + __builtin_ctz(mask);
+
+    return len < max ? len : max;
+}
+
+static size_t sse2_len(const char *s) {
+    return sse2_nlen(s, SIZE_MAX);
+}
+
+static size_t sse2_mismatch(const char *a, const char *b, size_t len) {
+    size_t i = 0;
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i lhs = _mm_loadu_si128((const __m128i *) (a + i)), rhs = _mm_loadu_si128((const __m128i *) (b + i));
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(lhs, rhs)) ^ 0xffff;
+
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return i + scalar_mismatch(a + i, b + i, len - i);
+}
+
+__attribute__((target("avx2"), no_sanitize_address)) static size_t avx2_nlen(const char *s, size_t max) {
+    const __m256i zero = _mm256_setzero_si256();
+    size_t align = (uintptr_t) s & 31;
+    const char *base = s - align;
+    unsigned int mask = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *) base), zero)) >> align;
+    size_t offset = 0;
+
+    while (!mask) {
+        base += 32;
+        offset = base - s;
+
+        if (offset >= max) {
+            return max;
+        }
+
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_load_si256((const __m256i *) base), zero));
+    }
+
+    size_t len = offset + __builtin_ctz(mask);
+
+    return len < max ? len : max;
+}
+
+__attribute__((target("avx2"))) static size_t avx2_len(const char *s) {
+    return avx2_nlen(s, SIZE_MAX);
+}
+
+__attribute__((target("avx2"))) static size_t avx2_mismatch(const char *a, const char *b, size_t len) {
+    size_t i = 0;
+
+    for (; i + 32 <= len; i += 32) {
+        __m256i lhs = _mm256_loadu_si256((const __m256i *) (a + i)), rhs = _mm256_loadu_si256((const __m256i *) (b + i));
+        unsigned int mask = ~(unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lhs, rhs));
+
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+
+    return i + sse2_mismatch(a + i, b + i, len - i);
+}
+
+static size_t (*len_kernel)(const char *) = &sse2_len;
+static size_t (*nlen_kernel)(const char *, size_t) = &sse2_nlen;
+static size_t (*mismatch_kernel)(const char *, const char *, size_t) = &sse2_mismatch;
+
+#else
+
+static size_t (*len_kernel)(const char *) = &scalar_len;
+static size_t (*nlen_kernel)(const char *, size_t) = &scalar_nlen;
+static size_t (*mismatch_kernel)(const char *, const char *, size_t) = &scalar_mismatch;
+
+#endif
+
+// Picks the widest kernels the CPU runs. Call it before any thread starts;
+// until then the defaults are used. FT_NM_SIMD=scalar|sse2 caps the choice.
+void strings_init(void) {
+    const char *cap = getenv("FT_NM_SIMD");
+
+    if (cap && !ft_strcmp(cap, "scalar")) {
+        len_kernel = &scalar_len;
+        nlen_kernel = &scalar_nlen;
+        mismatch_kernel = &scalar_mismatch;
+        return;
+    }
+
+#if defined(__x86_64__)
+    if ((!cap || ft_strcmp(cap, "sse2")) && __builtin_cpu_supports("avx2")) {
+        len_kernel = &avx2_len;
+        nlen_kernel = &avx2_nlen;
+        mismatch_kernel = &avx2_mismatch;
+    }
+#endif
+}
+
+size_t str_len(const char *s) {
+    return len_kernel(s);
+}
+
+size_t str_nlen(const char *s, size_t max) {
+    return nlen_kernel(s, max);
+}
+
+size_t str_mismatch(const char *a, const char *b, size_t len) {
+    return mismatch_kernel(a, b, len);
+}
+
+// Orders two names the way ft_strcmp would, given that neither holds a NUL.
+int str_compare(const char *a, size_t a_len, const char *b, size_t b_len) {
+    size_t len = a_len < b_len ? a_len : b_len, i = mismatch_kernel(a, b, len);
+
+    if (i < len) {
+        return (unsigned char) a[i] - (unsigned char) b[i];
+    }
+
+    return a_len < b_len ? -1 : a_len > b_len;
+}
@@ -0,0 +1,341 @@
+#include <libft/stdlib.h>
+#include <libft/string.h>
+
+#include "ft_nm.h"
+
+#define SORT_SMALL_RUN 32
+
+void symbol_table_init(struct symbol_table *table) {
+    table->entries = NULL;
+    table->scratch = NULL;
+    table->count = 0;
+    table->cap = 0;
+    table->sections = NULL;
+    table->sections_cap = 0;
+    table->strings = NULL;
+    table->strings_size = 0;
+}
+
+// Makes room for `count` entries and empties the table. The storage is kept
+// between calls, so consecutive archive members reuse the same arena.
+int symbol_table_reset(struct symbol_table *table, size_t count) {
+    table->count = 0;
+    table->strings = NULL;
+    table->strings_size = 0;
+
+    if (count <= table->cap) {
+        return 0;
+    }
+
+    ft_free(table->entries);
+    ft_free(table->scratch);
+    table->scratch = NULL;
+    table->cap = 0;
+
+    if (!(table->entries = ft_malloc(count * sizeof(struct symbol_entry)))) {
+        return ERR_NO_MEM;
+    }
+
+    table->cap = count;
+
+    return 0;
+}
+
+// Room for one type byte per section, kept between files like the entries.
+unsigned char *symbol_table_sections(struct symbol_table *table, size_t count) {
+    if (count <= table->sections_cap) {
+        return table->sections;
+    }
+
+    ft_free(table->sections);
+    table->sections_cap = 0;
+
+    if ((table->sections = ft_malloc(count))) {
+        table->sections_cap = count;
+    }
+
+    return table->sections;
+}
+
+void symbol_table_free(struct symbol_table *table) {
+    ft_free(table->entries);
+    ft_free(table->scratch);
+    ft_free(table->sections);
+    symbol_table_init(table);
+}
+
+// Keys hold the next 8 bytes of the name starting at `depth`, big-endian and
+// zero padded, so integer order matches ft_strcmp order on those bytes.
+static void symbol_rekey(struct symbol_entry *entries, size_t count, size_t depth) {
+    for (size_t i = 0; i < count; i++) {
+        entries[i].key = entries[i].st_name_len > depth
+                             ? symbol_key(entries[i].st_name + depth, entries[i].st_name_len - depth)
+                             : 0;
+    }
+}
+
+// A key whose last byte is NUL covers the end of the name, so two entries
+// with equal keys only need the rest of the string when it is not.
+static int compare_at(const struct symbol_entry *lhs, const struct symbol_entry *rhs, size_t depth) {
+    if (lhs->key != rhs->key) {
+        return lhs->key < rhs->key ? -1 : 1;
+    }
+
+    if (!(lhs->key & 0xff)) {
+        return 0;
+    }
+
+    return str_compare(lhs->st_name + depth + 8, lhs->st_name_len - depth - 8, rhs->st_name + depth + 8, rhs->st_name_len - depth - 8);
+}
+
+static void insertion_sort(struct symbol_entry *entries, size_t count, size_t depth) {
+    for (size_t i = 1; i < count; i++) {
+        struct symbol_entry entry = entries[i];
+        size_t j = i;
+
+        while (j && compare_at(&entries[j - 1], &entry, depth) > 0) {
+            entries[j] = entries[j - 1];
+            j--;
+        }
+
+        entries[j] = entry;
+    }
+}
+
+// Stable LSD radix sort on the 64-bit keys. Byte positions where every key
+// agrees (the shared "_ZN" of mangled names, for one) cost no scatter pass.
+static void radix_sort(struct symbol_entry *entries, struct symbol_entry *scratch, size_t count) {
+    size_t histogram[8][256];
+    struct symbol_entry *src = entries, *dst = scratch;
+
+    ft_bzero(histogram, sizeof(histogram));
+
+    for (size_t i = 0; i < count; i++) {
+        unsigned long key = entries[i].key;
+
+        for (int b = 0; b < 8; b++) {
+            histogram[b][(key >> (8 * b)) & 0xff]++;
+        }
+    }
+
+    for (int b = 0; b < 8; b++) {
+        size_t *offsets = histogram[b], offset = 0;
+
+        if (offsets[(src[0].key >> (8 * b)) & 0xff] == count) {
+            continue;
+        }
+
+        for (int c = 0; c < 256; c++) {
+            size_t n = offsets[c];
+            offsets[c] = offset;
+            offset += n;
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            dst[offsets[(src[i].key >> (8 * b)) & 0xff]++] = src[i];
+        }
+
+        struct symbol_entry *tmp = src;
+        src = dst;
+        dst = tmp;
+    }
+
+    if (src != entries) {
+        ft_memcpy(entries, src, count * sizeof(struct symbol_entry));
+    }
+}
+
+// Multikey sort on 8-byte slices: radix partition on the current slice, then
+// descend into every run that still ties with the next slice of the names.
+// A range that does not split at all moves on to the next slice in place.
+static void sort_range(struct symbol_entry *entries, struct symbol_entry *scratch, size_t count, size_t depth) {
+    while (true) {
+        if (depth) {
+            symbol_rekey(entries, count, depth);
+        }
+
+        if (count < SORT_SMALL_RUN) {
+            insertion_sort(entries, count, depth);
+            return;
+        }
+
+        radix_sort(entries, scratch, count);
+
+        if (entries[0].key != entries[count - 1].key) {
+            break;
+        }
+
+        if (!(entries[0].key & 0xff)) {
+            return;
+        }
+
+        depth += 8;
+    }
+
+    for (size_t lo = 0, hi; lo < count; lo = hi) {
+        for (hi = lo + 1; hi < count && entries[hi].key == entries[lo].key; hi++);
+
+        if (hi - lo > 1 && entries[lo].key & 0xff) {
+            sort_range(entries + lo, scratch + lo, hi - lo, depth + 8);
+        }
+    }
+}
+
+// Radix sort on keys set by the caller, then name order within each run of
+// equal keys: the numeric orders only look at names to break ties. Runs go
+// through the same multikey sort as the default order, so only tables with
+// ties pay for names, where sorting all of it by name first would not.
+static void sort_keyed(struct symbol_entry *entries, struct symbol_entry *scratch, size_t count) {
+    if (count < 2) {
+        return;
+    }
+
+    radix_sort(entries, scratch, count);
+
+    for (size_t lo = 0, hi; lo < count; lo = hi) {
+        for (hi = lo + 1; hi < count && entries[hi].key == entries[lo].key; hi++);
+
+        if (hi - lo > 1) {
+            symbol_rekey(entries + lo, hi - lo, 0);
+            sort_range(entries + lo, scratch + lo, hi - lo, 0);
+        }
+    }
+}
+
+static bool symbol_undefined(const struct symbol_entry *entry) {
+    return entry->type == 'w' || entry->type == 'U';
+}
+
+// -n: undefined symbols first, by name, then the rest by value. Undefined
+// symbols may carry a PLT address, so they are set apart before the value
+// becomes the key.
+static void sort_numeric(struct symbol_table *table) {
+    struct symbol_entry *entries = table->entries, *scratch = table->scratch;
+    size_t undefined = 0, defined = 0;
+
+    for (size_t i = 0; i < table->count; i++) {
+        if (symbol_undefined(&entries[i])) {
+            entries[undefined++] = entries[i];
+        } else {
+            scratch[defined] = entries[i];
+            scratch[defined++].key = entries[i].st_value;
+        }
+    }
+
+    ft_memcpy(entries + undefined, scratch, defined * sizeof(struct symbol_entry));
+
+    if (undefined > 1) {
+        symbol_rekey(entries, undefined, 0);
+        sort_range(entries, scratch, undefined, 0);
+    }
+
+    sort_keyed(entries + undefined, scratch + undefined, defined);
+}
+
+// --size-sort: like binutils, only defined symbols with a size are kept.
+static void sort_size(struct symbol_table *table) {
+    struct symbol_entry *entries = table->entries;
+    size_t kept = 0;
+
+    for (size_t i = 0; i < table->count; i++) {
+        if (!symbol_undefined(&entries[i]) && entries[i].st_size) {
+            entries[kept] = entries[i];
+            entries[kept++].key = entries[i].st_size;
+        }
+    }
+
+    table->count = kept;
+    sort_keyed(entries, table->scratch, kept);
+}
+
+static bool same_name(const struct symbol_entry *lhs, const struct symbol_entry *rhs) {
+    return lhs->st_name_len == rhs->st_name_len && str_mismatch(lhs->st_name, rhs->st_name, lhs->st_name_len) == lhs->st_name_len;
+}
+
+static bool same_value(const struct symbol_entry *lhs, const struct symbol_entry *rhs) {
+    bool undefined = symbol_undefined(lhs);
+
+    return undefined == symbol_undefined(rhs) && (undefined || lhs->st_value == rhs->st_value) && same_name(lhs, rhs);
+}
+
+static bool same_size(const struct symbol_entry *lhs, const struct symbol_entry *rhs) {
+    return lhs->st_size == rhs->st_size && same_name(lhs, rhs);
+}
+
+// Reverses the sorted table but keeps runs of entries that compare equal in
+// symbol table order, which is what a stable sort on the negated comparison
+// produced.
+static void reverse_table(struct symbol_table *table, bool (*same)(const struct symbol_entry *, const struct symbol_entry *)) {
+    struct symbol_entry *entries = table->entries, tmp;
+
+    if (table->count < 2) {
+        return;
+    }
+
+    for (size_t i = 0, j = table->count - 1; i < j; i++, j--) {
+        tmp = entries[i];
+        entries[i] = entries[j];
+        entries[j] = tmp;
+    }
+
+    for (size_t lo = 0, hi; lo < table->count; lo = hi) {
+        for (hi = lo + 1; hi < table->count && same(&entries[lo], &entries[hi]); hi++);
+
+        for (size_t i = lo, j = hi - 1; i < j; i++, j--) {
+            tmp = entries[i];
+            entries[i] = entries[j];
+            entries[j] = tmp;
+        }
+    }
+}
+
+// The order symbol_table_sort() puts two entries in, -r aside: 0 when only
+// their place in the symbol table tells them apart.
+int symbol_compare(const struct symbol_entry *lhs, const struct symbol_entry *rhs, int flags) {
+    if (flags & FLAG_SIZE_SORT && lhs->st_size != rhs->st_size) {
+        return lhs->st_size < rhs->st_size ? -1 : 1;
+    }
+
+    if (!(flags & FLAG_SIZE_SORT) && flags & FLAG_NUMERIC_SORT) {
+        bool undefined = symbol_undefined(lhs);
+
+        if (undefined != symbol_undefined(rhs)) {
+            return undefined ? -1 : 1;
+        }
+
+        if (!undefined && lhs->st_value != rhs->st_value) {
+            return lhs->st_value < rhs->st_value ? -1 : 1;
+        }
+    }
+
+    return str_compare(lhs->st_name, lhs->st_name_len, rhs->st_name, rhs->st_name_len);
+}
+
+// Name order by default; --size-sort wins over -n as it does in binutils.
+int symbol_table_sort(struct symbol_table *table, int flags) {
+    bool (*same)(const struct symbol_entry *, const struct symbol_entry *) = &same_name;
+
+    if (!table->count || (table->count < 2 && !(flags & FLAG_SIZE_SORT))) {
+        return 0;
+    }
+
+    if (!table->scratch && !(table->scratch = ft_malloc(table->cap * sizeof(struct symbol_entry)))) {
+        return ERR_NO_MEM;
+    }
+
+    if (flags & FLAG_SIZE_SORT) {
+        sort_size(table);
+        same = &same_size;
+    } else if (flags & FLAG_NUMERIC_SORT) {
+        sort_numeric(table);
+        same = &same_value;
+    } else {
+        sort_range(table->entries, table->scratch, table->count, 0);
+    }
+
+    if (flags & FLAG_REV_SORT) {
+        reverse_table(table, same);
+    }
+
+    return 0;
+}
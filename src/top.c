@@ -0,0 +1,264 @@
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <pthread.h>
+
+#include "ft_nm.h"
+
+// Where a winner of --top=K,per=archive came from. Names are copied, since
+// streamed members are dropped as soon as they are decoded.
+struct top_pick {
+    size_t offset;
+    char *member;
+    size_t member_len;
+};
+
+// The archive-wide heap. Members are decoded on the pool, so it is shared
+// behind a lock; ties go to the member found first in the archive, which
+// keeps the result independent of the order members finish in.
+struct top_merge {
+    pthread_mutex_t lock;
+    struct symbol_entry *entries;
+    struct top_pick *picks;
+    size_t count;
+};
+
+// Ranks by the key (size or value), then by name, then by member, the way
+// --size-sort -r and -n -r order a listing. Both heaps are rooted at their
+// worst entry, so a candidate that does not make the cut costs one compare.
+static bool top_worse(const struct symbol_entry *lhs, const struct symbol_entry *rhs, const struct top_pick *picks, size_t i, size_t j) {
+    if (lhs->key != rhs->key) {
+        return lhs->key < rhs->key;
+    }
+
+    int cmp = str_compare(lhs->st_name, lhs->st_name_len, rhs->st_name, rhs->st_name_len);
+
+    if (cmp || !picks) {
+        return cmp < 0;
+    }
+
+    return picks[i].offset > picks[j].offset;
+}
+
+static void top_swap(struct symbol_entry *entries, struct top_pick *picks, size_t i, size_t j) {
+    struct symbol_entry entry = entries[i];
+
+    entries[i] = entries[j];
+    entries[j] = entry;
+
+    if (picks) {
+        struct top_pick pick = picks[i];
+
+        picks[i] = picks[j];
+        picks[j] = pick;
+    }
+}
+
+static void top_sift_up(struct symbol_entry *entries, struct top_pick *picks, size_t i) {
+    while (i) {
+        size_t parent = (i - 1) / 2;
+
+        if (!top_worse(&entries[i], &entries[parent], picks, i, parent)) {
+            return;
+        }
+
+        top_swap(entries, picks, i, parent);
+        i = parent;
+    }
+}
+
+static void top_sift_down(struct symbol_entry *entries, struct top_pick *picks, size_t count, size_t i) {
+    while (true) {
+        size_t worst = i, left = 2 * i + 1, right = left + 1;
+
+        if (left < count && top_worse(&entries[left], &entries[worst], picks, left, worst)) {
+            worst = left;
+        }
+
+        if (right < count && top_worse(&entries[right], &entries[worst], picks, right, worst)) {
+            worst = right;
+        }
+
+        if (worst == i) {
+            return;
+        }
+
+        top_swap(entries, picks, i, worst);
+        i = worst;
+    }
+}
+
+// Pops the root to the end until the heap is gone, which leaves the winners
+// best first; -r lists them the other way round.
+static void top_order(struct nm_context *ctx, struct symbol_entry *entries, struct top_pick *picks, size_t count) {
+    for (size_t end = count; end > 1; end--) {
+        top_swap(entries, picks, 0, end - 1);
+        top_sift_down(entries, picks, end - 1, 0);
+    }
+
+    if (ctx->flags & FLAG_REV_SORT) {
+        for (size_t i = 0, j = count ? count - 1 : 0; i < j; i++, j--) {
+            top_swap(entries, picks, i, j);
+        }
+    }
+}
+
+// Only defined symbols that -g and -u let through compete; by=size also
+// leaves out the ones without a size, as --size-sort does.
+static bool top_eligible(const struct nm_context *ctx, const struct symbol_entry *entry) {
+    if (entry->type == 'w' || entry->type == 'U' || !symbol_selected(ctx, entry)) {
+        return false;
+    }
+
+    return !(ctx->flags & FLAG_SIZE_SORT) || entry->st_size;
+}
+
+// Called by the decoder with the candidate written just past the heap, at
+// entries[count]; the table holds room for one more than `limit`.
+void top_offer(struct nm_context *ctx, struct symbol_table *table, size_t limit) {
+    struct symbol_entry *entries = table->entries, *candidate = &entries[table->count];
+
+    if (!top_eligible(ctx, candidate)) {
+        return;
+    }
+
+    candidate->key = ctx->flags & FLAG_SIZE_SORT ? candidate->st_size : candidate->st_value;
+
+    if (table->count < limit) {
+        top_sift_up(entries, NULL, table->count++);
+    } else if (top_worse(&entries[0], candidate, NULL, 0, 0)) {
+        entries[0] = *candidate;
+        top_sift_down(entries, NULL, table->count, 0);
+    }
+}
+
+void top_finish(struct nm_context *ctx, struct symbol_table *table) {
+    top_order(ctx, table->entries, NULL, table->count);
+}
+
+static void top_pick_free(struct symbol_entry *entry, struct top_pick *pick) {
+    ft_free(entry->st_name);
+    ft_free(pick->member);
+}
+
+// Starts the archive-wide ranking of --top=K,per=archive; members then go to
+// top_member() instead of being listed.
+int top_begin(struct nm_context *ctx) {
+    struct top_merge *merge = ft_malloc(sizeof(struct top_merge));
+    size_t limit = ctx->opts->top;
+
+    if (!merge) {
+        return ERR_NO_MEM;
+    }
+
+    merge->entries = ft_malloc((limit + 1) * sizeof(struct symbol_entry));
+    merge->picks = ft_malloc((limit + 1) * sizeof(struct top_pick));
+    merge->count = 0;
+
+    if (!merge->entries || !merge->picks) {
+        ft_free(merge->entries);
+        ft_free(merge->picks);
+        ft_free(merge);
+        return ERR_NO_MEM;
+    }
+
+    pthread_mutex_init(&merge->lock, NULL);
+    ctx->top = merge;
+
+    return 0;
+}
+
+// Offers the winners of one member to the archive-wide heap.
+static int top_merge_table(struct top_merge *merge, size_t limit, const struct archive_member *member, const struct symbol_table *table) {
+    struct symbol_entry *entries = merge->entries;
+    struct top_pick *picks = merge->picks;
+    int err = 0;
+
+    for (size_t i = 0; !err && i < table->count; i++) {
+        const struct symbol_entry *entry = &table->entries[i];
+
+        entries[limit] = *entry;
+        picks[limit] = (struct top_pick){.offset = member->offset};
+
+        if (merge->count == limit && !top_worse(&entries[0], &entries[limit], picks, 0, limit)) {
+            continue;
+        }
+
+        size_t slot = merge->count < limit ? merge->count : 0, member_len = member->name ? member->name_len : 0;
+        char *name = ft_strndup(entry->st_name, entry->st_name_len), *member_name = ft_strndup(member->name ? member->name : "", member_len);
+
+        if (!name || !member_name) {
+            ft_free(name);
+            ft_free(member_name);
+            err = ERR_NO_MEM;
+            break;
+        }
+
+        if (merge->count == limit) {
+            top_pick_free(&entries[0], &picks[0]);
+        }
+
+        entries[slot] = *entry;
+        entries[slot].st_name = name;
+        picks[slot] = (struct top_pick){.offset = member->offset, .member = member_name, .member_len = member_len};
+
+        if (merge->count < limit) {
+            top_sift_up(entries, picks, merge->count++);
+        } else {
+            top_sift_down(entries, picks, merge->count, 0);
+        }
+    }
+
+    return err;
+}
+
+int top_member(struct nm_context *ctx, const struct archive_member *member) {
+    struct top_merge *merge = ctx->top;
+    int err = load_table(ctx, member->data, member->size);
+
+    if (err == ERR_NO_SYMS) {
+        return 0;
+    }
+
+    if (!err) {
+        pthread_mutex_lock(&merge->lock);
+        err = top_merge_table(merge, ctx->opts->top, member, &ctx->symbols);
+        pthread_mutex_unlock(&merge->lock);
+    }
+
+    if (err == ERR_NO_MEM) {
+        context_error(ctx, "ft_nm: not enough memory\n");
+    }
+
+    return err;
+}
+
+// Lists the archive-wide winners, a member label before every run that
+// comes from the same member, and ends the ranking.
+void top_end(struct nm_context *ctx) {
+    struct top_merge *merge = ctx->top;
+
+    if (!merge) {
+        return;
+    }
+
+    top_order(ctx, merge->entries, merge->picks, merge->count);
+
+    for (size_t lo = 0, hi; lo < merge->count; lo = hi) {
+        for (hi = lo + 1; hi < merge->count && merge->picks[hi].offset == merge->picks[lo].offset; hi++);
+
+        struct symbol_table run = {.entries = merge->entries + lo, .count = hi - lo};
+
+        emit_label(ctx, LABEL_MEMBER, merge->picks[lo].member, merge->picks[lo].member_len);
+        print_symbols(ctx, &run);
+    }
+
+    for (size_t i = 0; i < merge->count; i++) {
+        top_pick_free(&merge->entries[i], &merge->picks[i]);
+    }
+
+    pthread_mutex_destroy(&merge->lock);
+    ft_free(merge->entries);
+    ft_free(merge->picks);
+    ft_free(merge);
+    ctx->top = NULL;
+}
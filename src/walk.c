@@ -0,0 +1,343 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+#define WALK_HEAD 64
+
+// Directories still to scan. The owner pushes and pops at the end, so it
+// goes depth first over a hot cache; idle workers steal from the front,
+// which holds the oldest and usually largest subtrees.
+struct walk_queue {
+    pthread_mutex_t lock;
+    char **dirs;
+    size_t head;
+    size_t count;
+    size_t cap;
+};
+
+struct walker;
+
+struct walk_worker {
+    struct walker *walker;
+    size_t index;
+    pthread_t thread;
+    struct walk_queue queue;
+    struct file_list found;
+    struct nm_output err;
+    size_t errors;
+    bool failed;
+};
+
+// `queued` counts directories sitting in a queue, `pending` those queued or
+// being scanned; the walk is over when nothing is pending.
+struct walker {
+    struct walk_worker *workers;
+    size_t count;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t queued;
+    size_t pending;
+};
+
+static char *walk_join(const char *dir, const char *name) {
+    size_t dir_len = ft_strlen(dir), name_len = ft_strlen(name);
+    bool slash = dir_len && dir[dir_len - 1] != '/';
+    char *path = ft_malloc(dir_len + slash + name_len + 1);
+
+    if (!path) {
+        return NULL;
+    }
+
+    ft_memcpy(path, dir, dir_len);
+    path[dir_len] = '/';
+    ft_memcpy(path + dir_len + slash, name, name_len + 1);
+
+    return path;
+}
+
+static int walk_push(struct walk_worker *worker, char *dir) {
+    struct walk_queue *queue = &worker->queue;
+    struct walker *walker = worker->walker;
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->count == queue->cap) {
+        size_t live = queue->count - queue->head, cap = live * 2 > 16 ? live * 2 : 16;
+        char **dirs = ft_malloc(cap * sizeof(char *));
+
+        if (!dirs) {
+            pthread_mutex_unlock(&queue->lock);
+            return ERR_NO_MEM;
+        }
+
+        if (queue->dirs) {
+            ft_memcpy(dirs, queue->dirs + queue->head, live * sizeof(char *));
+            ft_free(queue->dirs);
+        }
+
+        queue->dirs = dirs;
+        queue->head = 0;
+        queue->count = live;
+        queue->cap = cap;
+    }
+
+    queue->dirs[queue->count++] = dir;
+    pthread_mutex_unlock(&queue->lock);
+
+    pthread_mutex_lock(&walker->lock);
+    walker->queued++;
+    walker->pending++;
+    pthread_cond_signal(&walker->cond);
+    pthread_mutex_unlock(&walker->lock);
+
+    return 0;
+}
+
+static char *walk_pop(struct walk_queue *queue, bool steal) {
+    char *dir = NULL;
+
+    pthread_mutex_lock(&queue->lock);
+
+    if (queue->head < queue->count) {
+        dir = steal ? queue->dirs[queue->head++] : queue->dirs[--queue->count];
+    }
+
+    if (queue->head == queue->count) {
+        queue->head = 0;
+        queue->count = 0;
+    }
+
+    pthread_mutex_unlock(&queue->lock);
+
+    return dir;
+}
+
+// Own work first, then the other workers in turn.
+static char *walk_take(struct walk_worker *worker) {
+    struct walker *walker = worker->walker;
+    char *dir = walk_pop(&worker->queue, false);
+
+    for (size_t i = 1; !dir && i < walker->count; i++) {
+        dir = walk_pop(&walker->workers[(worker->index + i) % walker->count].queue, true);
+    }
+
+    if (dir) {
+        pthread_mutex_lock(&walker->lock);
+        walker->queued--;
+        pthread_mutex_unlock(&walker->lock);
+    }
+
+    return dir;
+}
+
+static void walk_error(struct walk_worker *worker, const char *path, int err) {
+    output_printf(&worker->err, "ft_nm: %s: %s\n", path, strerror(err));
+    worker->errors++;
+}
+
+// Only files whose first bytes parse_magic() takes for an ELF file or an
+// archive are listed; everything else is dropped before it is ever mapped.
+static bool walk_candidate(int dir_fd, const char *name) {
+    char head[WALK_HEAD];
+    int fd = openat(dir_fd, name, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    ssize_t len = pread(fd, head, sizeof(head), 0);
+    int class = len > 0 ? parse_magic(head, len) : NOTELF;
+
+    close(fd);
+
+    return class == ELF32 || class == ELF64 || class == ARCH;
+}
+
+// Symbolic links are not followed, like find(1) without -L.
+static int walk_scan(struct walk_worker *worker, const char *dir) {
+    int dir_fd = open(dir, O_RDONLY | O_DIRECTORY);
+    DIR *handle = dir_fd >= 0 ? fdopendir(dir_fd) : NULL;
+    struct dirent *ent;
+    int err = 0;
+
+    if (!handle) {
+        walk_error(worker, dir, errno);
+
+        if (dir_fd >= 0) {
+            close(dir_fd);
+        }
+
+        return 0;
+    }
+
+    while (!err && (ent = readdir(handle))) {
+        const char *name = ent->d_name;
+        unsigned char type = ent->d_type;
+
+        if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2]))) {
+            continue;
+        }
+
+        if (type == DT_UNKNOWN) {
+            struct stat st;
+
+            if (fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW)) {
+                continue;
+            }
+
+            type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+
+        if ((type != DT_DIR && type != DT_REG) || (type == DT_REG && !walk_candidate(dir_fd, name))) {
+            continue;
+        }
+
+        char *path = walk_join(dir, name);
+
+        if (!path) {
+            err = ERR_NO_MEM;
+        } else if ((err = type == DT_DIR ? walk_push(worker, path) : file_list_push(&worker->found, path))) {
+            ft_free(path);
+        }
+    }
+
+    closedir(handle);
+
+    return err;
+}
+
+static void *walk_worker(void *data) {
+    struct walk_worker *worker = data;
+    struct walker *walker = worker->walker;
+
+    while (true) {
+        char *dir = walk_take(worker);
+
+        if (dir) {
+            worker->failed |= walk_scan(worker, dir) != 0;
+            ft_free(dir);
+
+            pthread_mutex_lock(&walker->lock);
+
+            if (!--walker->pending) {
+                pthread_cond_broadcast(&walker->cond);
+            }
+
+            pthread_mutex_unlock(&walker->lock);
+            continue;
+        }
+
+        pthread_mutex_lock(&walker->lock);
+
+        while (!walker->queued && walker->pending) {
+            pthread_cond_wait(&walker->cond, &walker->lock);
+        }
+
+        bool done = !walker->pending;
+
+        pthread_mutex_unlock(&walker->lock);
+
+        if (done) {
+            return NULL;
+        }
+    }
+}
+
+static int compare_paths(const void *lhs, const void *rhs) {
+    return ft_strcmp(*(char *const *) lhs, *(char *const *) rhs);
+}
+
+// Appends every ELF file and archive under the --recursive roots to `files`,
+// in path order. Directories are scanned by -j workers that steal from each
+// other once their own subtree runs dry. Returns 1 when some directory could
+// not be read.
+int walk_paths(struct nm_context *ctx, const struct file_list *roots, struct file_list *files) {
+    struct walker walker = {.count = ctx->opts->threads, .queued = 0, .pending = 0};
+    size_t first = files->count, started = 1;
+    bool unreadable = false;
+    int err = 0;
+
+    if (!(walker.workers = ft_malloc(walker.count * sizeof(struct walk_worker)))) {
+        return ERR_NO_MEM;
+    }
+
+    pthread_mutex_init(&walker.lock, NULL);
+    pthread_cond_init(&walker.cond, NULL);
+
+    for (size_t i = 0; i < walker.count; i++) {
+        struct walk_worker *worker = &walker.workers[i];
+
+        ft_bzero(worker, sizeof(*worker));
+        worker->walker = &walker;
+        worker->index = i;
+        pthread_mutex_init(&worker->queue.lock, NULL);
+        output_init(&worker->err, -1);
+    }
+
+    for (size_t i = 0; !err && i < roots->count; i++) {
+        char *root = ft_strdup(roots->files[i]);
+
+        if (!root || (err = walk_push(&walker.workers[0], root))) {
+            ft_free(root);
+            err = ERR_NO_MEM;
+        }
+    }
+
+    for (; !err && started < walker.count; started++) {
+        if (pthread_create(&walker.workers[started].thread, NULL, &walk_worker, &walker.workers[started])) {
+            break;
+        }
+    }
+
+    if (!err) {
+        walk_worker(&walker.workers[0]);
+    }
+
+    for (size_t i = 0; i < walker.count; i++) {
+        struct walk_worker *worker = &walker.workers[i];
+
+        if (i && i < started) {
+            pthread_join(worker->thread, NULL);
+        }
+
+        for (char *dir; (dir = walk_pop(&worker->queue, false));) {
+            ft_free(dir);
+        }
+
+        // The paths change hands; the ones that cannot are dropped.
+        for (size_t j = 0; j < worker->found.count; j++) {
+            if (err || (err = file_list_push(files, worker->found.files[j]))) {
+                ft_free(worker->found.files[j]);
+            }
+        }
+
+        if (worker->err.len) {
+            output_append(&ctx->err, worker->err.data, worker->err.len);
+            ctx->errors += worker->errors;
+        }
+
+        err = err ? err : worker->failed ? ERR_NO_MEM : 0;
+        unreadable |= worker->errors > 0;
+        file_list_free(&worker->found, worker->found.count);
+        output_free(&worker->err);
+        ft_free(worker->queue.dirs);
+        pthread_mutex_destroy(&worker->queue.lock);
+    }
+
+    context_flush_err(ctx);
+    pthread_cond_destroy(&walker.cond);
+    pthread_mutex_destroy(&walker.lock);
+    ft_free(walker.workers);
+
+    qsort(files->files + first, files->count - first, sizeof(char *), &compare_paths);
+
+    return err ? err : unreadable;
+}
@@ -0,0 +1,460 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <libft/stdlib.h>
+#include <libft/string.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "ft_nm.h"
+
+// Events closer together than this are taken as one edit: a linker or ar
+// writes its output in many steps.
+#define WATCH_SETTLE_MS 100
+#define WATCH_EVENTS    (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_ATTRIB)
+
+// What is kept of one ELF file or archive member between edits: its
+// identity and a copy of its decoded table, names included, so the input
+// does not have to stay mapped.
+struct watch_member {
+    char *name;
+    size_t name_len;
+    unsigned long size;
+    unsigned long date;
+    unsigned long hash;
+    int result;
+    struct symbol_table table;
+};
+
+struct watch_file {
+    const char *path;
+    const char *base;
+    int wd;
+    bool dirty;
+    bool changed;
+    bool loaded;
+    bool failed;
+    unsigned long size;
+    struct timespec mtime;
+    struct watch_member *members;
+    size_t count;
+};
+
+static void watch_member_free(struct watch_member *member) {
+    ft_free(member->name);
+    ft_free(member->table.entries);
+    ft_free((char *) member->table.strings);
+    ft_bzero(member, sizeof(*member));
+}
+
+static void watch_members_free(struct watch_member *members, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        watch_member_free(&members[i]);
+    }
+
+    ft_free(members);
+}
+
+// Copies the table just decoded into ctx->symbols, names and all.
+static int watch_snapshot(struct nm_context *ctx, struct symbol_table *table) {
+    const struct symbol_table *src = &ctx->symbols;
+    size_t strings_size = 0;
+    char *strings;
+
+    for (size_t i = 0; i < src->count; i++) {
+        strings_size += src->entries[i].st_name_len;
+    }
+
+    symbol_table_init(table);
+
+    if (!(table->entries = ft_malloc((src->count ? src->count : 1) * sizeof(struct symbol_entry)))) {
+        return ERR_NO_MEM;
+    }
+
+    if (!(strings = ft_malloc(strings_size ? strings_size : 1))) {
+        ft_free(table->entries);
+        table->entries = NULL;
+        return ERR_NO_MEM;
+    }
+
+    table->count = src->count;
+    table->cap = src->count;
+    table->strings = strings;
+    table->strings_size = strings_size;
+
+    for (size_t i = 0; i < src->count; i++) {
+        table->entries[i] = src->entries[i];
+        table->entries[i].st_name = strings;
+        ft_memcpy(strings, src->entries[i].st_name, src->entries[i].st_name_len);
+        strings += src->entries[i].st_name_len;
+    }
+
+    return 0;
+}
+
+static int watch_load(struct nm_context *ctx, struct watch_member *member, unsigned char *data, size_t size) {
+    member->result = load_table(ctx, data, size);
+
+    if (member->result == ERR_NO_MEM) {
+        return ERR_NO_MEM;
+    }
+
+    if (member->result) {
+        ctx->symbols.count = 0;
+    }
+
+    return watch_snapshot(ctx, &member->table);
+}
+
+// Notes that `file` changed and, with --watch=changes, prints how under a
+// "path" or "path(member)" label. The listing at startup is not a change,
+// but a file that could not be listed then shows up as all additions.
+static void watch_report(struct nm_context *ctx, struct watch_file *file, const struct watch_member *old, const struct watch_member *new) {
+    static const struct symbol_table empty = {0};
+    const struct watch_member *named = new ? new : old;
+    size_t path_len = ft_strlen(file->path), len = path_len;
+    char *label = NULL;
+
+    file->changed = true;
+
+    if (ctx->opts->watch != WATCH_CHANGES || (!file->loaded && !file->failed)) {
+        return;
+    }
+
+    if (named->name && (label = ft_malloc(path_len + named->name_len + 3))) {
+        ft_memcpy(label, file->path, path_len);
+        label[path_len] = '(';
+        ft_memcpy(label + path_len + 1, named->name, named->name_len);
+        label[path_len + 1 + named->name_len] = ')';
+        len = path_len + named->name_len + 2;
+    }
+
+    diff_symbols(ctx, old ? &old->table : &empty, new ? &new->table : &empty, label ? label : file->path, len);
+    ft_free(label);
+}
+
+// Finds the old member `member` replaces: same name and same occurrence of
+// that name, looking right after the previous match first.
+static struct watch_member *watch_match(struct watch_file *file, bool *taken, size_t *hint, const struct archive_member *member) {
+    for (size_t n = 0; n < file->count; n++) {
+        size_t i = (*hint + n) % file->count;
+        struct watch_member *old = &file->members[i];
+
+        if (!taken[i] && old->name && old->name_len == member->name_len && !ft_memcmp(old->name, member->name, member->name_len)) {
+            taken[i] = true;
+            *hint = i + 1;
+            return old;
+        }
+    }
+
+    return NULL;
+}
+
+// Re-decodes what changed in an archive. Members are told apart by size,
+// date and a hash of their bytes; the ones that match keep their table.
+static int watch_archive(struct nm_context *ctx, struct watch_file *file, unsigned char *mem, size_t size, struct watch_member **members, size_t *count) {
+    struct archive_index index;
+    bool *taken = ft_malloc(file->count + 1);
+    size_t hint = 0;
+    int err = archive_index_build(&index, mem, size);
+
+    if (!taken || err == ERR_NO_MEM || !(*members = ft_malloc((index.count + 1) * sizeof(struct watch_member)))) {
+        ft_free(taken);
+        archive_index_free(&index);
+        return ERR_NO_MEM;
+    }
+
+    ft_bzero(taken, file->count + 1);
+    *count = 0;
+    err = 0;
+
+    for (size_t i = 0; !err && i < index.count; i++) {
+        const struct archive_member *member = &index.members[i];
+
+        if (member->class != ELF32 && member->class != ELF64) {
+            continue;
+        }
+
+        struct watch_member *new = &(*members)[(*count)++], *old = watch_match(file, taken, &hint, member);
+
+        ft_bzero(new, sizeof(*new));
+        new->size = member->size;
+        new->date = ft_atoi(member->header->ar_date);
+        new->hash = hash_bytes(member->data, member->size);
+        new->name_len = member->name_len;
+
+        if (!(new->name = ft_strndup(member->name, member->name_len))) {
+            err = ERR_NO_MEM;
+            break;
+        }
+
+        if (old && old->size == new->size && old->date == new->date && old->hash == new->hash) {
+            new->result = old->result;
+            new->table = old->table;
+            symbol_table_init(&old->table);
+            continue;
+        }
+
+        if ((err = watch_load(ctx, new, member->data, member->size))) {
+            break;
+        }
+
+        watch_report(ctx, file, old, new);
+    }
+
+    for (size_t i = 0; !err && i < file->count; i++) {
+        if (!taken[i]) {
+            watch_report(ctx, file, &file->members[i], NULL);
+        }
+    }
+
+    ft_free(taken);
+    archive_index_free(&index);
+
+    return err;
+}
+
+// Brings the snapshot of `file` up to date, reporting what changed when
+// only changes are printed. A file that cannot be read keeps its last
+// snapshot until it can; one that was never read is reported once.
+static int watch_refresh(struct nm_context *ctx, struct watch_file *file) {
+    int fd = open(file->path, O_RDONLY);
+    struct stat st;
+    int err = 0;
+
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || !st.st_size) {
+        if (fd >= 0) {
+            close(fd);
+        }
+
+        if (!file->loaded && !file->failed) {
+            context_error(ctx, "ft_nm: %s: Unable to read file\n", file->path);
+            file->failed = true;
+        }
+
+        return 0;
+    }
+
+    if (file->loaded && file->size == (unsigned long) st.st_size && file->mtime.tv_sec == st.st_mtim.tv_sec && file->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        close(fd);
+        return 0;
+    }
+
+    unsigned char *mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    close(fd);
+
+    if (mem == MAP_FAILED) {
+        context_error(ctx, "ft_nm: %s: Unable to mmap memory: %s\n", file->path, strerror(errno));
+        file->failed |= !file->loaded;
+        return 0;
+    }
+
+    struct watch_member *members = NULL;
+    size_t count = 0;
+    int class = parse_magic((char *) mem, st.st_size);
+
+    if (class == ARCH) {
+        err = watch_archive(ctx, file, mem, st.st_size, &members, &count);
+    } else if (class == ELF32 || class == ELF64) {
+        struct watch_member *old = file->count && !file->members[0].name ? &file->members[0] : NULL;
+
+        if (!(members = ft_malloc(sizeof(struct watch_member)))) {
+            err = ERR_NO_MEM;
+        } else {
+            ft_bzero(members, sizeof(*members));
+            count = 1;
+            members->size = st.st_size;
+            members->hash = hash_bytes(mem, st.st_size);
+
+            if (old && old->size == members->size && old->hash == members->hash) {
+                members->result = old->result;
+                members->table = old->table;
+                symbol_table_init(&old->table);
+            } else if (!(err = watch_load(ctx, members, mem, st.st_size))) {
+                watch_report(ctx, file, old, members);
+            }
+        }
+    } else if (!file->loaded && !file->failed) {
+        context_error(ctx, "ft_nm: %s: file format not recognized\n", file->path);
+        file->failed = true;
+    }
+
+    munmap(mem, st.st_size);
+
+    if (err) {
+        watch_members_free(members, count);
+        return err;
+    }
+
+    if (class == ARCH || class == ELF32 || class == ELF64) {
+        watch_members_free(file->members, file->count);
+        file->members = members;
+        file->count = count;
+        file->loaded = true;
+        file->size = st.st_size;
+        file->mtime = st.st_mtim;
+    }
+
+    return 0;
+}
+
+// The whole listing again, from the snapshots, as a plain run would print it.
+static void watch_emit(struct nm_context *ctx, struct watch_file *files, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        struct watch_file *file = &files[i];
+
+        if (!file->loaded) {
+            continue;
+        }
+
+        if (count > 1) {
+            emit_label(ctx, LABEL_FILE, file->path, ft_strlen(file->path));
+        }
+
+        for (size_t m = 0; m < file->count; m++) {
+            struct watch_member *member = &file->members[m];
+
+            if (member->name) {
+                emit_label(ctx, LABEL_MEMBER, member->name, member->name_len);
+            } else if (member->result == ERR_NO_SYMS) {
+                output_printf(ctx->opts->format == FORMAT_TEXT ? &ctx->out : &ctx->err, "ft_nm: %s: no symbols\n", file->path);
+                continue;
+            }
+
+            print_symbols(ctx, &member->table);
+        }
+    }
+
+    output_flush(&ctx->out);
+    context_flush_err(ctx);
+}
+
+// Watches the directories rather than the files themselves, so a file that
+// a build replaces by renaming a new one over it is still followed.
+static int watch_subscribe(struct nm_context *ctx, int inotify, struct watch_file *file) {
+    const char *slash = NULL;
+
+    for (const char *iter = file->path; *iter; iter++) {
+        slash = *iter == '/' ? iter : slash;
+    }
+
+    char *dir = slash ? ft_strndup(file->path, slash == file->path ? 1 : (size_t) (slash - file->path)) : ft_strdup(".");
+
+    if (!dir) {
+        return ERR_NO_MEM;
+    }
+
+    file->base = slash ? slash + 1 : file->path;
+    file->wd = inotify_add_watch(inotify, dir, WATCH_EVENTS);
+
+    if (file->wd < 0) {
+        context_error(ctx, "ft_nm: %s: Unable to watch directory: %s\n", dir, strerror(errno));
+    }
+
+    ft_free(dir);
+
+    return 0;
+}
+
+// Marks the files an event batch touched; a lost batch marks them all.
+static void watch_events(int inotify, struct watch_file *files, size_t count) {
+    char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t len = read(inotify, buffer, sizeof(buffer));
+
+    for (char *iter = buffer; len > 0 && iter < buffer + len;) {
+        const struct inotify_event *event = (const struct inotify_event *) iter;
+
+        for (size_t i = 0; i < count; i++) {
+            if (event->mask & IN_Q_OVERFLOW || (event->wd == files[i].wd && event->len && !ft_strcmp(event->name, files[i].base))) {
+                files[i].dirty = true;
+            }
+        }
+
+        iter += sizeof(struct inotify_event) + event->len;
+    }
+}
+
+// --watch: lists the files once, then stays resident and, after each edit,
+// re-decodes only the files and archive members that changed. The listing
+// is printed again in full, or with --watch=changes only the symbols that
+// were added, removed or changed, in the --diff format.
+int watch_files(struct nm_context *ctx, char **paths, size_t count) {
+    struct watch_file *files = ft_malloc(count * sizeof(struct watch_file));
+    int inotify = inotify_init1(IN_CLOEXEC), err = 0;
+
+    if (!files || inotify < 0) {
+        context_error(ctx, "ft_nm: Unable to watch files: %s\n", files ? strerror(errno) : "not enough memory");
+        ft_free(files);
+
+        if (inotify >= 0) {
+            close(inotify);
+        }
+
+        return 1;
+    }
+
+    ft_bzero(files, count * sizeof(struct watch_file));
+
+    // Changes are only printed relative to a name-ordered table.
+    if (ctx->opts->watch == WATCH_CHANGES) {
+        ctx->flags &= ~(FLAG_NO_SORT | FLAG_REV_SORT | FLAG_NUMERIC_SORT | FLAG_SIZE_SORT);
+    }
+
+    for (size_t i = 0; !err && i < count; i++) {
+        files[i].path = paths[i];
+
+        if (!(err = watch_subscribe(ctx, inotify, &files[i]))) {
+            err = watch_refresh(ctx, &files[i]);
+        }
+    }
+
+    if (!err) {
+        watch_emit(ctx, files, count);
+    }
+
+    while (!err) {
+        struct pollfd pfd = {.fd = inotify, .events = POLLIN};
+
+        if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+            break;
+        }
+
+        do {
+            watch_events(inotify, files, count);
+        } while (poll(&pfd, 1, WATCH_SETTLE_MS) > 0);
+
+        bool changed = false;
+
+        for (size_t i = 0; !err && i < count; i++) {
+            if (files[i].dirty) {
+                files[i].dirty = false;
+                files[i].changed = false;
+                err = watch_refresh(ctx, &files[i]);
+                changed |= files[i].changed;
+            }
+        }
+
+        if (!err && changed && ctx->opts->watch == WATCH_FULL) {
+            watch_emit(ctx, files, count);
+        } else {
+            output_flush(&ctx->out);
+            context_flush_err(ctx);
+        }
+    }
+
+    if (err == ERR_NO_MEM) {
+        context_error(ctx, "ft_nm: not enough memory\n");
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        watch_members_free(files[i].members, files[i].count);
+    }
+
+    ft_free(files);
+    close(inotify);
+
+    return 1;
+}
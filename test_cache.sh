@@ -0,0 +1,63 @@
+#!/bin/bash
+# Runs ft_nm twice over the same cache directory and checks that the second
+# run is a hit with the same output, that -u or a touched file is a miss,
+# and that the cache files themselves are reproducible.
+NM=${NM:-$PWD/ft_nm}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+printf 'extern int helper(void);\nint counter;\nstatic int hidden(void) { return 1; }\nint main(void) { return helper() + counter + hidden(); }\n' > fixture.c
+cc -c fixture.c -o fixture.o || exit 1
+
+status=0
+
+# Runs ft_nm with the cache in `dir` and prints its "hits misses" counts.
+run() {
+  local dir=$1 out=$2
+  shift 2
+  "$NM" --cache-dir="$dir" --cache-stats "$@" > "$out" 2> stats.txt
+  sed -n 's/^ft_nm: cache: \([0-9]*\) hits, \([0-9]*\) misses.*/\1 \2/p' stats.txt
+}
+
+expect() {
+  if [ "$2" = "$3" ]; then
+    echo "ok   $1"
+  else
+    echo "FAIL $1: expected '$3', got '$2'"
+    status=1
+  fi
+}
+
+expect "first run misses" "$(run cache first.txt fixture.o)" "0 1"
+expect "second run hits" "$(run cache second.txt fixture.o)" "1 0"
+cmp -s first.txt second.txt && cmp -s first.txt <("$NM" fixture.o)
+expect "replay is byte-identical" "$?" "0"
+
+expect "-u misses" "$(run cache undefined.txt -u fixture.o)" "0 1"
+expect "-u replays -u" "$(cat undefined.txt)" "                 U helper"
+expect "-g misses" "$(run cache extern.txt -g fixture.o)" "0 1"
+
+sleep 0.01
+touch fixture.o
+expect "touched file misses" "$(run cache touched.txt fixture.o)" "0 1"
+cmp -s first.txt touched.txt
+expect "touched output unchanged" "$?" "0"
+
+# The same input stored twice makes the same bytes, padding included.
+run fresh fresh.txt fixture.o > /dev/null
+cmp -s "$(ls -t cache/*.nmc | head -1)" fresh/*.nmc
+expect "cache files are reproducible" "$?" "0"
+
+# A temporary file left by a writer that died is removed on eviction; one
+# whose writer still runs is kept.
+sh -c 'exit 0' &
+dead=$!
+wait $dead
+touch "cache/0123456789abcdef.$dead.1.tmp" "cache/0123456789abcdef.$$.1.tmp"
+rm -f cache/*.nmc
+run cache evicted.txt --cache-size=1 fixture.o > /dev/null
+expect "stale .tmp removed" "$(ls cache | grep -c "\.$dead\.1\.tmp$")" "0"
+expect "live .tmp kept" "$(ls cache | grep -c "\.$$\.1\.tmp$")" "1"
+
+exit $status
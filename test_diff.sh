@@ -0,0 +1,82 @@
+#!/bin/bash
+# Compares fixture pairs with ft_nm --diff and checks the -, + and ~ lines,
+# the member labels of archives and the exit status: 0 when nothing changed,
+# 1 when something did, 2 when a file could not be read.
+NM=${NM:-$PWD/ft_nm}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+printf 'int kept(void) { return 0; }\nint removed(void) { return 1; }\nint retyped;\nstatic int dup = 1;\nint use_dup(void) { return dup; }\n' > old.c
+printf 'int kept(void) { return 0; }\nint added(void) { return 2; }\nconst int retyped = 3;\nstatic int dup = 1;\nint use_dup(void) { return dup; }\n' > new.c
+printf 'static int dup = 2;\nint other_dup(void) { return dup; }\n' > dup.c
+printf 'static int pad = 3;\nstatic int dup = 2;\nint other_dup(void) { return dup + pad; }\n' > moved.c
+for name in old new dup moved; do
+  cc -c -fno-common $name.c || exit 1
+done
+ld -r old.o dup.o -o old_dup.o && ld -r new.o moved.o -o new_dup.o || exit 1
+cp old.o a.o && cp new.o b.o && cp old.o c.o || exit 1
+ar rcs old.a a.o b.o && ar rcs new.a a.o c.o || exit 1
+
+status=0
+
+# Runs ft_nm --diff on two files and compares its output and exit status
+# with expected.txt and `code`.
+check() {
+  local name=$1 code=$2
+  shift 2
+  "$NM" --diff "$@" > actual.txt 2>&1
+  local ret=$?
+  if [ $ret = "$code" ] && cmp -s expected.txt actual.txt; then
+    echo "ok   $name"
+  else
+    echo "FAIL $name: exit $ret, expected $code"
+    diff expected.txt actual.txt
+    status=1
+  fi
+}
+
+: > expected.txt
+check "identical files" 0 old.o old.o
+
+{
+  printf '+ 000000000000000b T added\n'
+  printf -- '- 000000000000000b T removed\n'
+  printf '~ 0000000000000000 B -> 0000000000000000 R retyped\n'
+} > expected.txt
+check "added, removed and retyped" 1 old.o new.o
+
+# Duplicate names are paired in order, so only the copy that moved shows.
+{
+  printf '+ 000000000000000b T added\n'
+  printf '~ 0000000000000004 d -> 0000000000000008 d dup\n'
+  printf '+ 0000000000000004 d pad\n'
+  printf -- '- 000000000000000b T removed\n'
+  printf '~ 0000000000000000 B -> 0000000000000000 R retyped\n'
+} > expected.txt
+check "duplicate names" 1 old_dup.o new_dup.o
+
+# Members are matched by name: b.o renamed to c.o is one gone, one new.
+{
+  printf '\nb.o:\n'
+  printf -- '- 000000000000000b T added\n'
+  printf -- '- 0000000000000000 d dup\n'
+  printf -- '- 0000000000000000 T kept\n'
+  printf -- '- 0000000000000000 R retyped\n'
+  printf -- '- 0000000000000016 T use_dup\n'
+  printf '\nc.o:\n'
+  printf '+ 0000000000000000 d dup\n'
+  printf '+ 0000000000000000 T kept\n'
+  printf '+ 000000000000000b T removed\n'
+  printf '+ 0000000000000000 B retyped\n'
+  printf '+ 0000000000000016 T use_dup\n'
+} > expected.txt
+check "archive with a renamed member" 1 old.a new.a
+
+: > expected.txt
+check "identical archives" 0 new.a new.a
+
+printf 'ft_nm: missing.o: Unable to open file: No such file or directory\n' > expected.txt
+check "missing file" 2 old.o missing.o
+
+exit $status
@@ -0,0 +1,51 @@
+#!/bin/bash
+# Checks --regex and --match against nm piped through a filter on the name,
+# over every file matching $1 (libc.a by default). Patterns are picked so
+# that the literal prefix the filter tests first is anchored, absent, cut
+# short by a quantifier or an alternation, or is the whole glob.
+NM=${NM:-$PWD/ft_nm}
+CORPUS=${1:-/usr/lib/x86_64-linux-gnu/libc.a}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+status=0
+
+# The names of the symbols listed, absolute ones left out as ft_nm skips
+# them.
+names() {
+  awk 'NF >= 2 && $(NF - 1) !~ /^[aA]$/ { print $NF }'
+}
+
+# Runs ft_nm with `option` and compares the names it lists with those of
+# nm whose name matches the extended regex `expected`.
+check() {
+  local option=$1 expected=$2 file total=0
+  for file in $CORPUS; do
+    "$NM" "$option" "$file" 2> /dev/null | names > "$WORK/actual.txt"
+    nm "$file" 2> /dev/null | names | grep -E -- "$expected" > "$WORK/expected.txt"
+    if ! cmp -s "$WORK/expected.txt" "$WORK/actual.txt"; then
+      echo "FAIL $option $file"
+      diff "$WORK/expected.txt" "$WORK/actual.txt" | head
+      status=1
+      return
+    fi
+    total=$((total + $(wc -l < "$WORK/actual.txt")))
+  done
+  echo "ok   $option ($total names)"
+}
+
+check --regex='^mem' '^mem'
+check --regex='alloc' 'alloc'
+check --regex='^__?str' '^__?str'
+check --regex='^_*mallo*c' '^_*mallo*c'
+check --regex='^_{2}libc' '^_{2}libc'
+check --regex='^(mem|str)cpy$' '^(mem|str)cpy$'
+check --regex='^mem|free$' '^mem|free$'
+check --match='mem*' '^mem'
+check --match='*alloc' 'alloc$'
+check --match='str?cpy' '^str.cpy$'
+check --match='[mc]alloc' '^[mc]alloc$'
+check --match='printf' '^printf$'
+check --match='print' '^print$'
+
+exit $status
@@ -0,0 +1,48 @@
+#!/bin/bash
+# Queries archives with --lookup and checks the lines printed and the exit
+# status: 0 when every name is found, 1 when one is not or when the archive
+# has no symbol index.
+NM=${NM:-$PWD/ft_nm}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+printf 'int foo(void) { return 0; }\n' > foo.c
+printf 'int bar(void) { return 1; }\n' > bar.c
+cc -c foo.c && cc -c bar.c || exit 1
+ar rcs lib.a foo.o bar.o && ar rcS noindex.a foo.o || exit 1
+
+status=0
+
+# Runs ft_nm and compares its output and exit status with expected.txt and
+# `code`.
+check() {
+  local name=$1 code=$2
+  shift 2
+  "$NM" "$@" > actual.txt 2>&1
+  local ret=$?
+  if [ $ret = "$code" ] && cmp -s expected.txt actual.txt; then
+    echo "ok   $name"
+  else
+    echo "FAIL $name: exit $ret, expected $code"
+    diff expected.txt actual.txt
+    status=1
+  fi
+}
+
+printf 'lib.a(foo.o): foo\nlib.a(bar.o): bar\n' > expected.txt
+check "all found" 0 --lookup=foo --lookup=bar lib.a
+
+printf 'lib.a(foo.o): 0000000000000000 T foo\n' > expected.txt
+check "details" 0 --lookup-details --lookup=foo lib.a
+
+printf 'lib.a(foo.o): foo\nft_nm: lib.a: baz: not found\n' > expected.txt
+check "one not found" 1 --lookup=foo --lookup=baz lib.a
+
+printf 'ft_nm: noindex.a: no archive symbol index\n' > expected.txt
+check "no symbol index" 1 --lookup=foo noindex.a
+
+printf 'ft_nm: noindex.a: no archive symbol index\nlib.a(foo.o): foo\n' > expected.txt
+check "one file without an index" 1 --lookup=foo noindex.a lib.a
+
+exit $status
@@ -0,0 +1,48 @@
+#!/bin/bash
+# Pipes requests into ft_nm --server and checks the frames it answers with,
+# byte for byte: "<status> <stdout bytes> <stderr bytes>\n" and both streams.
+NM=${NM:-$PWD/ft_nm}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+printf 'extern int helper(void);\nint counter;\nint main(void) { return helper() + counter; }\n' > fixture.c
+cc -c -fno-common fixture.c -o a.out && cp a.out other.o || exit 1
+
+status=0
+
+check() {
+  if cmp -s expected.txt actual.txt; then
+    echo "ok   $1"
+  else
+    echo "FAIL $1"
+    diff expected.txt actual.txt
+    status=1
+  fi
+}
+
+# Flags only (the file list defaults to a.out), a blank line that gets no
+# frame, two files, then the error frames.
+printf -- '-u\n\n-g a.out other.o\nmissing.o\n- a.out\n-x a.out\n-pr a.out\n' | "$NM" --server > actual.txt
+{
+  printf '0 26 0\n                 U helper\n'
+  printf '0 172 0\n\na.out:\n0000000000000000 B counter\n                 U helper\n0000000000000000 T main\n'
+  printf '\nother.o:\n0000000000000000 B counter\n                 U helper\n0000000000000000 T main\n'
+  printf '1 0 47\nUnable to open file: No such file or directory\n'
+  printf '1 0 57\nft_nm: -: standard input is not available in server mode\n'
+  printf "1 0 29\nft_nm: invalid option -- 'x'\n"
+  printf '1 0 37\nft_nm: conflicting options -p and -r\n'
+} > expected.txt
+check "line requests"
+
+# --null: fields end with NUL and a request with an empty field, so file
+# names may hold spaces.
+cp a.out 'with space.o'
+printf -- '-u\0with space.o\0\0-\0\0' | "$NM" --server --null > actual.txt
+{
+  printf '0 26 0\n                 U helper\n'
+  printf '1 0 57\nft_nm: -: standard input is not available in server mode\n'
+} > expected.txt
+check "null requests"
+
+exit $status
@@ -0,0 +1,51 @@
+#!/bin/bash
+# Compares the numeric orders with nm over every file matching $1 (libc.a by
+# default), ties included. Known differences are evened out on both sides:
+# absolute symbols, which ft_nm leaves out, and 'n' printed for 'r'. Files
+# whose default listing already differs for other reasons are skipped.
+NM=${NM:-$PWD/ft_nm}
+CORPUS=${1:-/usr/lib/x86_64-linux-gnu/libc.a}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+status=0
+
+normalize() {
+  awk 'NF < 2 { print; next } $(NF - 1) !~ /^[aA]$/ && !/: no symbols$/ { if ($(NF - 1) == "n") $(NF - 1) = "r"; print }'
+}
+
+# Lists `file` with both tools and `flags`; true when the listings agree.
+same() {
+  local file=$1
+  shift
+  "$NM" "$@" "$file" 2>&1 | normalize > "$WORK/actual.txt"
+  nm "$@" "$file" 2>&1 | normalize > "$WORK/expected.txt"
+  cmp -s "$WORK/expected.txt" "$WORK/actual.txt"
+}
+
+files=()
+for file in $CORPUS; do
+  if same "$file"; then
+    files+=("$file")
+  else
+    echo "skip $file"
+  fi
+done
+
+for flags in -n --size-sort -S "-r -n" "-r --size-sort" "-n -S"; do
+  failed=0
+  for file in "${files[@]}"; do
+    if ! same "$file" $flags; then
+      echo "FAIL $flags $file"
+      diff "$WORK/expected.txt" "$WORK/actual.txt" | head
+      failed=1
+    fi
+  done
+  if [ $failed = 0 ]; then
+    echo "ok   $flags (${#files[@]} files)"
+  else
+    status=1
+  fi
+done
+
+exit $status
@@ -0,0 +1,38 @@
+#!/bin/bash
+# Lists a large archive with --memory-limit=16K, which sorts its members
+# through temporary files, and checks the output is the in-memory one for
+# the default, -n, -r and -p orders.
+NM=${NM:-$PWD/ft_nm}
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+cd "$WORK" || exit 1
+
+# Members of thousands of symbols. Both halves of the first define the same
+# static names and the undefined ones all sit at 0, so ties on the name and
+# on the value cross run boundaries.
+for part in a b; do
+  for i in $(seq 3000); do
+    echo "static int s$i = $i; extern int u$i; int *p_${part}_$i = &u$i; int *q_${part}_$i = &s$i;"
+  done > $part.c
+  cc -c -fno-common $part.c || exit 1
+done
+ld -r a.o b.o -o both.o || exit 1
+printf 'int main(void) { return 0; }\n' > small.c
+cc -c small.c || exit 1
+ar rcs big.a both.o small.o a.o b.o || exit 1
+
+status=0
+
+for flags in "" -n -r -p "-r -n"; do
+  "$NM" $flags big.a > expected.txt 2>&1
+  TMPDIR=$WORK "$NM" --memory-limit=16K $flags big.a > actual.txt 2>&1
+  if cmp -s expected.txt actual.txt && [ -s actual.txt ]; then
+    echo "ok   '$flags'"
+  else
+    echo "FAIL '$flags'"
+    diff expected.txt actual.txt | head
+    status=1
+  fi
+done
+
+exit $status